@@ -0,0 +1,530 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+// Local stand-in for the ectf-net serial bridge.
+//
+// Each bridge listens on a TCP port and forwards bytes in both directions
+// between the connected client and a device, which is one of:
+//
+//   PORT=pty            a new pseudo-terminal, whose path is printed
+//   PORT=serial:PATH    a serial device, configured for 115200 8-N-1 raw
+//   PORT=exec:COMMAND   a simulated board, run with its stdin/stdout as the
+//                       device's UART
+//
+// All bridges share one epoll loop. Each direction is queued in a pipe and
+// moved with splice() so that the bytes never pass through user space. If the
+// kernel cannot splice a file type, that direction falls back to read/write.
+// Per-bridge byte rates and queueing latency are printed to stderr every
+// --stats-interval seconds. Queueing latency is the time from a direction's
+// queue becoming non-empty until it has been fully drained again.
+//
+// Like the ectf-net bridge, one client is served per port. A new connection
+// replaces the old one, and device output with no client attached is dropped.
+
+#define MAX_BRIDGES 1024
+#define MAX_EVENTS 256
+#define SPILL_SIZE 4096
+#define BRIDGE_BAUD B115200
+
+typedef struct endpoint ENDPOINT;
+typedef struct bridge BRIDGE;
+
+// Bytes flowing from one endpoint to the other, queued in a pipe
+typedef struct {
+  ENDPOINT *src;
+  ENDPOINT *dst;
+  int pipe[2];
+  uint32_t pipe_size;
+  uint32_t queued;
+  bool splice_in;
+  bool splice_out;
+
+  // Used when the destination cannot be spliced to
+  uint8_t spill[SPILL_SIZE];
+  uint32_t spill_off;
+  uint32_t spill_len;
+
+  struct timespec pending_since;
+  uint64_t bytes;
+  uint64_t bytes_reported;
+  uint64_t drains;
+  double latency_sum;
+  double latency_max;
+} FLOW;
+
+// Role of an epoll registration
+enum { KIND_LISTEN, KIND_CLIENT, KIND_DEVICE, KIND_TIMER };
+
+struct endpoint {
+  int kind;
+  int fd;
+  uint32_t events;
+  BRIDGE *bridge;
+};
+
+struct bridge {
+  uint16_t port;
+  char spec[256];
+  ENDPOINT listener;
+  ENDPOINT client;
+  ENDPOINT device;
+  FLOW to_device;
+  FLOW to_client;
+  pid_t child;
+};
+
+static int epoll_fd;
+static BRIDGE bridges[MAX_BRIDGES];
+static int num_bridges;
+
+// Current monotonic time in seconds
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double elapsed_since(struct timespec *start) {
+  return now_seconds() - (start->tv_sec + start->tv_nsec / 1e9);
+}
+
+static void die(const char *what) {
+  perror(what);
+  exit(1);
+}
+
+static void set_nonblocking(int fd) {
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+// Configure a terminal for raw 115200 8-N-1 operation
+static void make_raw(int fd) {
+  struct termios tio;
+  if (tcgetattr(fd, &tio) != 0) {
+    return;
+  }
+  cfmakeraw(&tio);
+  cfsetispeed(&tio, BRIDGE_BAUD);
+  cfsetospeed(&tio, BRIDGE_BAUD);
+  tio.c_cflag |= CLOCAL | CREAD;
+  tcsetattr(fd, TCSANOW, &tio);
+}
+
+// Add, change or remove an endpoint's epoll registration to match `events`
+static void watch(ENDPOINT *ep, uint32_t events) {
+  if (ep->fd < 0 || ep->events == events) {
+    return;
+  }
+
+  struct epoll_event ev = {.events = events, .data.ptr = ep};
+  int op = ep->events == 0 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+  if (events == 0) {
+    op = EPOLL_CTL_DEL;
+  }
+  if (epoll_ctl(epoll_fd, op, ep->fd, &ev) != 0) {
+    die("epoll_ctl");
+  }
+  ep->events = events;
+}
+
+// Bytes that can be added to a flow's queue without blocking
+static uint32_t flow_space(FLOW *flow) { return flow->pipe_size - flow->queued; }
+
+// Recompute what a bridge's client and device endpoints wait for
+static void update_interest(BRIDGE *b) {
+  if (b->client.fd >= 0) {
+    uint32_t events = 0;
+    if (flow_space(&b->to_device) > 0) {
+      events |= EPOLLIN;
+    }
+    if (b->to_client.queued > 0 || b->to_client.spill_len > 0) {
+      events |= EPOLLOUT;
+    }
+    watch(&b->client, events | EPOLLRDHUP);
+  }
+
+  uint32_t events = 0;
+  if (flow_space(&b->to_client) > 0) {
+    events |= EPOLLIN;
+  }
+  if (b->to_device.queued > 0 || b->to_device.spill_len > 0) {
+    events |= EPOLLOUT;
+  }
+  watch(&b->device, events);
+}
+
+static void flow_init(FLOW *flow, ENDPOINT *src, ENDPOINT *dst) {
+  memset(flow, 0, sizeof(*flow));
+  flow->src = src;
+  flow->dst = dst;
+  flow->splice_in = true;
+  flow->splice_out = true;
+  if (pipe2(flow->pipe, O_NONBLOCK) != 0) {
+    die("pipe2");
+  }
+  flow->pipe_size = fcntl(flow->pipe[0], F_GETPIPE_SZ);
+}
+
+// Drop everything queued in a flow
+static void flow_reset(FLOW *flow) {
+  uint8_t discard[SPILL_SIZE];
+  while (read(flow->pipe[0], discard, sizeof(discard)) > 0)
+    ;
+  flow->queued = 0;
+  flow->spill_len = 0;
+  flow->spill_off = 0;
+}
+
+// Move bytes from a flow's source into its queue.
+// Returns false if the source has closed.
+static bool flow_fill(FLOW *flow) {
+  uint32_t space = flow_space(flow);
+  ssize_t n = -1;
+
+  if (space == 0) {
+    return true;
+  }
+
+  if (flow->splice_in) {
+    n = splice(flow->src->fd, NULL, flow->pipe[1], NULL, space,
+               SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    if (n < 0 && errno == EINVAL) {
+      flow->splice_in = false;
+    }
+  }
+
+  if (!flow->splice_in) {
+    uint8_t buf[SPILL_SIZE];
+    n = read(flow->src->fd, buf, space < sizeof(buf) ? space : sizeof(buf));
+    if (n > 0 && write(flow->pipe[1], buf, n) != n) {
+      die("write to queue");
+    }
+  }
+
+  if (n == 0) {
+    return false;
+  }
+  if (n < 0) {
+    // A pty master reads EIO while no slave is open, which is not a close
+    return errno == EAGAIN || errno == EINTR || errno == EIO;
+  }
+
+  if (flow->queued == 0 && flow->spill_len == 0) {
+    clock_gettime(CLOCK_MONOTONIC, &flow->pending_since);
+  }
+  flow->queued += n;
+  return true;
+}
+
+// Record that a flow's queue has been fully drained
+static void flow_drained(FLOW *flow) {
+  double latency = elapsed_since(&flow->pending_since);
+  flow->drains++;
+  flow->latency_sum += latency;
+  if (latency > flow->latency_max) {
+    flow->latency_max = latency;
+  }
+}
+
+// Move bytes from a flow's queue into its destination.
+// Returns false if the destination has closed.
+static bool flow_drain(FLOW *flow) {
+  uint64_t before = flow->bytes;
+  ssize_t n;
+
+  if (flow->splice_out && flow->queued > 0) {
+    n = splice(flow->pipe[0], NULL, flow->dst->fd, NULL, flow->queued,
+               SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    if (n > 0) {
+      flow->queued -= n;
+      flow->bytes += n;
+    } else if (n < 0 && errno == EINVAL) {
+      flow->splice_out = false;
+    } else if (n < 0 && errno != EAGAIN && errno != EINTR) {
+      return false;
+    }
+  }
+
+  if (!flow->splice_out) {
+    if (flow->spill_len == 0 && flow->queued > 0) {
+      n = read(flow->pipe[0], flow->spill, sizeof(flow->spill));
+      if (n > 0) {
+        flow->queued -= n;
+        flow->spill_off = 0;
+        flow->spill_len = n;
+      }
+    }
+    if (flow->spill_len > 0) {
+      n = write(flow->dst->fd, flow->spill + flow->spill_off, flow->spill_len);
+      if (n > 0) {
+        flow->spill_off += n;
+        flow->spill_len -= n;
+        flow->bytes += n;
+      } else if (n < 0 && errno != EAGAIN && errno != EINTR) {
+        return false;
+      }
+    }
+  }
+
+  if (flow->bytes != before && flow->queued == 0 && flow->spill_len == 0) {
+    flow_drained(flow);
+  }
+  return true;
+}
+
+static void close_client(BRIDGE *b) {
+  watch(&b->client, 0);
+  close(b->client.fd);
+  b->client.fd = -1;
+  flow_reset(&b->to_client);
+  flow_reset(&b->to_device);
+}
+
+static void accept_client(BRIDGE *b) {
+  int fd = accept4(b->listener.fd, NULL, NULL, SOCK_NONBLOCK);
+  if (fd < 0) {
+    return;
+  }
+
+  // A new connection replaces the old one
+  if (b->client.fd >= 0) {
+    close_client(b);
+  }
+
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  b->client.fd = fd;
+  b->client.events = 0;
+}
+
+// Open the device side of a bridge from its specification
+static void open_device(BRIDGE *b) {
+  int fd;
+
+  if (strcmp(b->spec, "pty") == 0) {
+    fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0) {
+      die("posix_openpt");
+    }
+    // Hold the slave open so the master does not report EIO between users
+    int slave = open(ptsname(fd), O_RDWR | O_NOCTTY);
+    make_raw(slave);
+    printf("bridge %u: %s\n", b->port, ptsname(fd));
+  } else if (strncmp(b->spec, "serial:", 7) == 0) {
+    fd = open(b->spec + 7, O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+      die(b->spec + 7);
+    }
+    make_raw(fd);
+    printf("bridge %u: %s\n", b->port, b->spec + 7);
+  } else if (strncmp(b->spec, "exec:", 5) == 0) {
+    int pair[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0) {
+      die("socketpair");
+    }
+    b->child = fork();
+    if (b->child == 0) {
+      dup2(pair[1], STDIN_FILENO);
+      dup2(pair[1], STDOUT_FILENO);
+      close(pair[0]);
+      close(pair[1]);
+      execl("/bin/sh", "sh", "-c", b->spec + 5, (char *)NULL);
+      _exit(127);
+    }
+    close(pair[1]);
+    fd = pair[0];
+    printf("bridge %u: pid %d\n", b->port, (int)b->child);
+  } else {
+    fprintf(stderr, "ERROR: unknown device '%s'\n", b->spec);
+    exit(1);
+  }
+
+  set_nonblocking(fd);
+  b->device.fd = fd;
+}
+
+static void open_listener(BRIDGE *b) {
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  struct sockaddr_in addr = {.sin_family = AF_INET,
+                             .sin_port = htons(b->port),
+                             .sin_addr.s_addr = htonl(INADDR_ANY)};
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+      listen(fd, 4) != 0) {
+    die("bind");
+  }
+
+  b->listener.fd = fd;
+  watch(&b->listener, EPOLLIN);
+}
+
+static void print_stats(double interval) {
+  for (int i = 0; i < num_bridges; i++) {
+    BRIDGE *b = &bridges[i];
+    FLOW *flows[2] = {&b->to_device, &b->to_client};
+    const char *names[2] = {"tcp->dev", "dev->tcp"};
+
+    fprintf(stderr, "bridge %u:", b->port);
+    for (int f = 0; f < 2; f++) {
+      FLOW *flow = flows[f];
+      double rate = (flow->bytes - flow->bytes_reported) / interval;
+      double avg = flow->drains ? flow->latency_sum / flow->drains : 0;
+      fprintf(stderr,
+              " %s %llu B %.1f B/s queue avg %.3f ms max %.3f ms%s", names[f],
+              (unsigned long long)flow->bytes, rate, avg * 1000,
+              flow->latency_max * 1000,
+              flow->splice_in && flow->splice_out ? " (splice)" : "");
+      flow->bytes_reported = flow->bytes;
+    }
+    fprintf(stderr, "\n");
+  }
+}
+
+static void handle(ENDPOINT *ep, uint32_t events) {
+  BRIDGE *b = ep->bridge;
+
+  if (ep->kind == KIND_LISTEN) {
+    accept_client(b);
+  } else if (ep->kind == KIND_CLIENT) {
+    bool open = true;
+    if (events & EPOLLIN) {
+      open = flow_fill(&b->to_device);
+    }
+    if (open && (events & EPOLLOUT)) {
+      open = flow_drain(&b->to_client);
+    }
+    if (!open || (events & (EPOLLHUP | EPOLLERR))) {
+      close_client(b);
+    }
+  } else if (ep->kind == KIND_DEVICE) {
+    if (events & EPOLLIN) {
+      if (!flow_fill(&b->to_client)) {
+        fprintf(stderr, "bridge %u: device closed\n", b->port);
+        watch(&b->device, 0);
+        close(b->device.fd);
+        b->device.fd = -1;
+        return;
+      }
+      // Device output with no client attached is dropped
+      if (b->client.fd < 0) {
+        flow_reset(&b->to_client);
+      }
+    }
+    if (events & EPOLLOUT) {
+      flow_drain(&b->to_device);
+    }
+  }
+
+  // Forward whatever just arrived without waiting for another wakeup
+  if (b->client.fd >= 0 && b->device.fd >= 0) {
+    if (b->to_device.queued > 0) {
+      flow_drain(&b->to_device);
+    }
+    if (b->to_client.queued > 0) {
+      flow_drain(&b->to_client);
+    }
+  }
+
+  if (b->device.fd >= 0) {
+    update_interest(b);
+  }
+}
+
+int main(int argc, char **argv) {
+  double stats_interval = 5;
+
+  if (argc < 2) {
+    fprintf(stderr,
+            "Usage: %s [--stats-interval SECONDS] PORT=pty|serial:PATH|"
+            "exec:COMMAND ...\n",
+            argv[0]);
+    return 1;
+  }
+
+  signal(SIGPIPE, SIG_IGN);
+  epoll_fd = epoll_create1(0);
+  setvbuf(stdout, NULL, _IOLBF, 0);
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--stats-interval") == 0 && i + 1 < argc) {
+      stats_interval = atof(argv[++i]);
+      continue;
+    }
+
+    char *eq = strchr(argv[i], '=');
+    if (eq == NULL || num_bridges == MAX_BRIDGES) {
+      fprintf(stderr, "ERROR: bad bridge '%s'\n", argv[i]);
+      return 1;
+    }
+
+    BRIDGE *b = &bridges[num_bridges++];
+    b->port = atoi(argv[i]);
+    snprintf(b->spec, sizeof(b->spec), "%s", eq + 1);
+    b->listener = (ENDPOINT){KIND_LISTEN, -1, 0, b};
+    b->client = (ENDPOINT){KIND_CLIENT, -1, 0, b};
+    b->device = (ENDPOINT){KIND_DEVICE, -1, 0, b};
+    flow_init(&b->to_device, &b->client, &b->device);
+    flow_init(&b->to_client, &b->device, &b->client);
+
+    open_device(b);
+    open_listener(b);
+    update_interest(b);
+  }
+
+  // Periodic statistics
+  ENDPOINT timer = {KIND_TIMER, timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK),
+                    0, NULL};
+  if (stats_interval > 0) {
+    struct itimerspec its;
+    its.it_interval.tv_sec = (time_t)stats_interval;
+    its.it_interval.tv_nsec =
+        (long)((stats_interval - (time_t)stats_interval) * 1e9);
+    its.it_value = its.it_interval;
+    timerfd_settime(timer.fd, 0, &its, NULL);
+    watch(&timer, EPOLLIN);
+  }
+
+  struct epoll_event events[MAX_EVENTS];
+  while (true) {
+    int n = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+    if (n < 0 && errno != EINTR) {
+      die("epoll_wait");
+    }
+
+    for (int i = 0; i < n; i++) {
+      ENDPOINT *ep = events[i].data.ptr;
+      if (ep->kind == KIND_TIMER) {
+        uint64_t expirations;
+        if (read(timer.fd, &expirations, sizeof(expirations)) > 0) {
+          print_stats(stats_interval * expirations);
+        }
+        continue;
+      }
+      handle(ep, events[i].events);
+    }
+
+    // Reap simulated boards that have exited
+    while (waitpid(-1, NULL, WNOHANG) > 0)
+      ;
+  }
+}
@@ -1,24 +0,0 @@
-/**
- * @file feature_list.h
- * @author Frederich Stine
- * @brief File that contains header information for use of the feature list
- * @date 2023
- *
- * This source file is part of an example system for MITRE's 2023 Embedded
- * System CTF (eCTF). This code is being provided only for educational purposes
- * for the 2023 MITRE eCTF competition, and may not meet MITRE standards for
- * quality. Use this code at your own risk!
- *
- * @copyright Copyright (c) 2023 The MITRE Corporation
- */
-
-#ifndef __FEATURE_LIST_
-#define __FEATURE_LIST_
-
-#include <stdint.h>
-
-#define NUM_FEATURES 3
-#define FEATURE_END 0x7C0
-#define FEATURE_SIZE 64
-
-#endif
@@ -0,0 +1,52 @@
+/**
+ * @file sig_cache.h
+ * @brief Cache of feature signatures verified since reset
+ * @date 2023
+ *
+ * The feature signing key never changes and a paired fob sends the same
+ * signatures on every unlock, so a signature only needs its scalar
+ * multiplications the first time it is seen. Verified signatures are
+ * remembered as keyed digests of everything hydro_sign_verify checks, under a
+ * key drawn at reset, so a cache hit stands for an earlier successful
+ * verification of exactly the same inputs.
+ */
+
+#ifndef SIG_CACHE_H
+#define SIG_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hydrogen.h"
+
+#include "feature_list.h"
+
+// Enough for every feature a fob can send
+#define SIG_CACHE_ENTRIES NUM_FEATURES
+
+/**
+ * @brief Draw the digest key and empty the cache
+ *
+ * Must be called after hydro_init.
+ */
+void sig_cache_init(void);
+
+/**
+ * @brief Verify a signature, skipping the curve arithmetic for signatures
+ * already verified since reset
+ *
+ * Takes the same arguments as hydro_sign_verify.
+ *
+ * @param signature the signature
+ * @param message the signed message
+ * @param message_len the message length
+ * @param context the signing context
+ * @param public_key the signing public key
+ * @return int 0 if the signature is valid, -1 if not
+ */
+int sig_cache_verify(const uint8_t signature[hydro_sign_BYTES],
+                     const void *message, size_t message_len,
+                     const char context[hydro_sign_CONTEXTBYTES],
+                     const uint8_t public_key[hydro_sign_PUBLICKEYBYTES]);
+
+#endif // SIG_CACHE_H
@@ -121,6 +121,21 @@ void Firmware_Startup(void)
           "        strlt   r2, [r0], #4\n"
           "        blt     zero_loop");
 
+    //
+    // Paint the application stack with a known pattern so that the stack
+    // high-water mark can be measured at runtime.  The pattern must match
+    // STACK_PAINT_PATTERN in stack.h.
+    //
+    __asm("    ldr     r0, =_stack_bottom\n"
+          "    ldr     r1, =0xC5C5C5C5\n"
+          "    mov     r2, sp\n"
+          "    .thumb_func\n"
+          "paint_loop:\n"
+          "        cmp     r0, r2\n"
+          "        it      lt\n"
+          "        strlt   r1, [r0], #4\n"
+          "        blt     paint_loop");
+
     //
     // Call the application's entry point.
     //
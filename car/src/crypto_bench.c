@@ -0,0 +1,342 @@
+/**
+ * @file crypto_bench.c
+ * @brief Microbenchmark of the libhydrogen primitives and link codecs the
+ * protocol is built on
+ * @date 2023
+ *
+ * Built as its own program, both for the host (`make bench_crypto` in `sim/`,
+ * timed in nanoseconds) and as a firmware image for the car's board (`make
+ * crypto_bench` in `car/`, timed in DWT cycles and written to UART 0).
+ *
+ * Every result is one JSON line:
+ *
+ *   {"bench":"secretbox_encrypt","bytes":4,"iterations":64,"unit":"cycles",
+ *    "per_op":12345}
+ *
+ * on a single line, and the run starts with a line naming the platform and
+ * clock, so that results can be compared across compiler flags and
+ * libhydrogen versions with a line-by-line diff or a script.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "driverlib/sw_crc.h"
+#include "hydrogen.h"
+
+#include "board_link.h"
+#include "fec.h"
+
+#ifdef TIVA_C
+#include "driverlib/sysctl.h"
+
+#include "uart.h"
+
+// Cortex-M4 debug registers for the DWT cycle counter
+#define DEMCR (*(volatile uint32_t *)0xE000EDFC)
+#define DEMCR_TRCENA (1 << 24)
+#define DWT_CTRL (*(volatile uint32_t *)0xE0001000)
+#define DWT_CTRL_CYCCNTENA 1
+#define DWT_CYCCNT (*(volatile uint32_t *)0xE0001004)
+
+#define BENCH_PLATFORM "tm4c123"
+#define BENCH_UNIT "cycles"
+
+// Iterations per benchmark are multiplied by this
+#define BENCH_SCALE 1
+#else
+#include <stdio.h>
+#include <time.h>
+
+#define BENCH_PLATFORM "host"
+#define BENCH_UNIT "ns"
+#define BENCH_SCALE 100
+#endif
+
+// Plaintext lengths of the encrypted board link messages: a handshake
+// request, an ACK, a handshake nonce or UNLOCK, and a START
+static const uint32_t message_lengths[] = {0, sizeof(uint8_t), sizeof(uint32_t),
+                                           sizeof(FEATURE_DATA)};
+
+#define NUM_MESSAGE_LENGTHS                                                    \
+  (sizeof(message_lengths) / sizeof(message_lengths[0]))
+
+/**
+ * @brief Start the benchmark clock
+ */
+static void bench_clock_init(void) {
+#ifdef TIVA_C
+  DEMCR |= DEMCR_TRCENA;
+  DWT_CYCCNT = 0;
+  DWT_CTRL |= DWT_CTRL_CYCCNTENA;
+#endif
+}
+
+/**
+ * @brief Read the benchmark clock
+ *
+ * @return uint32_t DWT cycles on the board, nanoseconds on the host. Only the
+ * difference of two readings less than 2^32 units apart is meaningful.
+ */
+static uint32_t bench_clock(void) {
+#ifdef TIVA_C
+  return DWT_CYCCNT;
+#else
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint32_t)(now.tv_sec * 1000000000ull + now.tv_nsec);
+#endif
+}
+
+/**
+ * @brief Write a string to the benchmark output
+ *
+ * @param text the string
+ */
+static void bench_write(const char *text) {
+#ifdef TIVA_C
+  uart_write(HOST_UART, (uint8_t *)text, strlen(text));
+#else
+  fputs(text, stdout);
+#endif
+}
+
+/**
+ * @brief Write an unsigned number in decimal to the benchmark output
+ *
+ * @param value the number
+ */
+static void bench_write_u64(uint64_t value) {
+  char digits[21];
+  uint32_t i = sizeof(digits) - 1;
+
+  digits[i] = '\0';
+  do {
+    digits[--i] = '0' + value % 10;
+    value /= 10;
+  } while (value);
+
+  bench_write(&digits[i]);
+}
+
+/**
+ * @brief Write one result line
+ *
+ * @param bench the benchmark name
+ * @param bytes the input length
+ * @param iterations the number of timed operations
+ * @param total the total time of all of them
+ */
+static void bench_result(const char *bench, uint32_t bytes,
+                         uint32_t iterations, uint64_t total) {
+  bench_write("{\"bench\":\"");
+  bench_write(bench);
+  bench_write("\",\"bytes\":");
+  bench_write_u64(bytes);
+  bench_write(",\"iterations\":");
+  bench_write_u64(iterations);
+  bench_write(",\"unit\":\"" BENCH_UNIT "\",\"per_op\":");
+  bench_write_u64(total / iterations);
+  bench_write("}\r\n");
+}
+
+// Everything the benchmarks work on, kept out of the stack
+static uint8_t plaintext[MESSAGE_MAX_LENGTH];
+static uint8_t ciphertext[hydro_secretbox_HEADERBYTES + MESSAGE_MAX_LENGTH];
+static uint8_t frame[FRAME_MAX_LENGTH];
+static uint8_t coded[FEC_CODED_LENGTH(FRAME_MAX_LENGTH)];
+static uint8_t key[hydro_secretbox_KEYBYTES];
+static uint8_t signature[hydro_sign_BYTES];
+static uint8_t digest[hydro_hash_BYTES];
+static char hex[2 * FRAME_MAX_LENGTH + 1];
+static hydro_sign_keypair keypair;
+
+// Some output of every operation, so that none of them are optimized out
+static volatile uint32_t sink;
+
+/**
+ * @brief Time secretbox encryption and decryption at every message length
+ */
+static void bench_secretbox(void) {
+  for (uint32_t i = 0; i < NUM_MESSAGE_LENGTHS; i++) {
+    uint32_t length = message_lengths[i];
+    uint32_t iterations = 64 * BENCH_SCALE;
+    uint64_t encrypt = 0, decrypt = 0;
+
+    for (uint32_t j = 0; j < iterations; j++) {
+      uint32_t start = bench_clock();
+      hydro_secretbox_encrypt(ciphertext, plaintext, length, 0, "boardmsg",
+                              key);
+      uint32_t middle = bench_clock();
+      sink += hydro_secretbox_decrypt(plaintext, ciphertext,
+                                      hydro_secretbox_HEADERBYTES + length, 0,
+                                      "boardmsg", key);
+      uint32_t end = bench_clock();
+
+      encrypt += middle - start;
+      decrypt += end - middle;
+    }
+
+    bench_result("secretbox_encrypt", length, iterations, encrypt);
+    bench_result("secretbox_decrypt", length, iterations, decrypt);
+  }
+}
+
+/**
+ * @brief Time signing and verifying a feature-sized message
+ */
+static void bench_sign(void) {
+  uint32_t length = 5; // car ID and feature number, as the car verifies them
+  uint32_t iterations = 4 * BENCH_SCALE;
+  uint64_t create = 0, verify = 0;
+
+  for (uint32_t j = 0; j < iterations; j++) {
+    uint32_t start = bench_clock();
+    hydro_sign_create(signature, plaintext, length, "feature", keypair.sk);
+    uint32_t middle = bench_clock();
+    sink += hydro_sign_verify(signature, plaintext, length, "feature",
+                              keypair.pk);
+    uint32_t end = bench_clock();
+
+    create += middle - start;
+    verify += end - middle;
+  }
+
+  bench_result("sign_create", length, iterations, create);
+  bench_result("sign_verify", length, iterations, verify);
+}
+
+/**
+ * @brief Time drawing random numbers and hashing
+ */
+static void bench_random_hash(void) {
+  uint32_t iterations = 1024 * BENCH_SCALE;
+  uint64_t total = 0;
+
+  for (uint32_t j = 0; j < iterations; j++) {
+    uint32_t start = bench_clock();
+    sink += hydro_random_u32();
+    total += bench_clock() - start;
+  }
+  bench_result("random_u32", 4, iterations, total);
+
+  for (uint32_t i = 0; i < NUM_MESSAGE_LENGTHS; i++) {
+    uint32_t length = message_lengths[i];
+    iterations = 64 * BENCH_SCALE;
+    total = 0;
+
+    for (uint32_t j = 0; j < iterations; j++) {
+      uint32_t start = bench_clock();
+      hydro_hash_hash(digest, sizeof(digest), plaintext, length, "benchmsg",
+                      NULL);
+      total += bench_clock() - start;
+      sink += digest[0];
+    }
+    bench_result("hash_hash", length, iterations, total);
+  }
+}
+
+/**
+ * @brief Time hex encoding and decoding of a key
+ */
+static void bench_hex(void) {
+  uint32_t iterations = 256 * BENCH_SCALE;
+  uint64_t encode = 0, decode = 0;
+
+  for (uint32_t j = 0; j < iterations; j++) {
+    uint32_t start = bench_clock();
+    hydro_bin2hex(hex, sizeof(hex), key, sizeof(key));
+    uint32_t middle = bench_clock();
+    sink += hydro_hex2bin(key, sizeof(key), hex, 2 * sizeof(key), NULL, NULL);
+    uint32_t end = bench_clock();
+
+    encode += middle - start;
+    decode += end - middle;
+  }
+
+  bench_result("bin2hex", sizeof(key), iterations, encode);
+  bench_result("hex2bin", sizeof(key), iterations, decode);
+}
+
+/**
+ * @brief Time the CRC and Reed-Solomon codecs on the longest frame
+ */
+static void bench_codecs(void) {
+  uint32_t iterations = 64 * BENCH_SCALE;
+  uint64_t crc = 0, encode = 0, decode = 0, correct = 0;
+
+  hydro_random_buf(frame, sizeof(frame));
+
+  for (uint32_t j = 0; j < iterations; j++) {
+    uint32_t corrected;
+
+    uint32_t start = bench_clock();
+    sink += Crc16(0, frame, sizeof(frame));
+    uint32_t crc_end = bench_clock();
+    uint32_t coded_len = fec_encode(coded, frame, sizeof(frame));
+    uint32_t encode_end = bench_clock();
+    sink += fec_decode(frame, coded, coded_len, &corrected);
+    uint32_t decode_end = bench_clock();
+
+    // A worst case block: as many bad bytes as can be corrected
+    fec_encode(coded, frame, sizeof(frame));
+    for (uint32_t k = 0; k < FEC_MAX_ERRORS; k++) {
+      coded[k * 3] ^= 0x5A;
+    }
+    uint32_t correct_start = bench_clock();
+    sink += fec_decode(frame, coded, coded_len, &corrected);
+    uint32_t correct_end = bench_clock();
+
+    crc += crc_end - start;
+    encode += encode_end - crc_end;
+    decode += decode_end - encode_end;
+    correct += correct_end - correct_start;
+  }
+
+  bench_result("crc16", sizeof(frame), iterations, crc);
+  bench_result("fec_encode", sizeof(frame), iterations, encode);
+  bench_result("fec_decode_clean", sizeof(frame), iterations, decode);
+  bench_result("fec_decode_errors", sizeof(frame), iterations, correct);
+}
+
+/**
+ * @brief Main function for the benchmark
+ *
+ * Runs every benchmark once and then stops.
+ */
+int main(void) {
+#ifdef TIVA_C
+  uart_init();
+#endif
+  bench_clock_init();
+
+  hydro_init();
+  fec_init();
+  hydro_secretbox_keygen(key);
+  hydro_sign_keygen(&keypair);
+  hydro_random_buf(plaintext, sizeof(plaintext));
+
+  bench_write("{\"platform\":\"" BENCH_PLATFORM "\",\"unit\":\"" BENCH_UNIT
+              "\"");
+#ifdef TIVA_C
+  bench_write(",\"clock_hz\":");
+  bench_write_u64(SysCtlClockGet());
+#endif
+  bench_write("}\r\n");
+
+  bench_secretbox();
+  bench_sign();
+  bench_random_hash();
+  bench_hex();
+  bench_codecs();
+
+  bench_write("{\"done\":true}\r\n");
+
+#ifdef TIVA_C
+  while (true)
+    ;
+#else
+  return 0;
+#endif
+}
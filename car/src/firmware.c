@@ -27,13 +27,14 @@
 #include "driverlib/sysctl.h"
 #include "driverlib/timer.h"
 
-#include "secrets.h"
-
 #include "board_link.h"
 #include "debug.h"
 #include "enc.h"
 #include "feature_list.h"
 #include "hwsec.h"
+#include "secrets_section.h"
+#include "sig_cache.h"
+#include "stack.h"
 #include "uart.h"
 
 /*** Structure definitions ***/
@@ -44,36 +45,42 @@ typedef struct {
   uint8_t signature[hydro_sign_BYTES];
 } __attribute__((packed)) ENABLE_PACKET;
 
-typedef struct {
-  uint32_t car_id;
-  uint8_t num_active;
-  uint8_t features[NUM_FEATURES];
-  uint8_t signatures[NUM_FEATURES][hydro_sign_BYTES];
-} FEATURE_DATA;
-
 /*** Macro Definitions ***/
 // Definitions for unlock message location in EEPROM
 #define UNLOCK_EEPROM_LOC 0x7C0
 #define UNLOCK_EEPROM_SIZE 64
 
+// Trailer written to the host after every unlock attempt so that the host can
+// stop reading immediately: UNLOCK_TRAILER, a status character, a space, the
+// number of host bytes written from the wait for the handshake request to the
+// trailer as 8 hex digits, then "\r\n"
+#define UNLOCK_TRAILER "\r\n%%UNLOCK-END "
+#define UNLOCK_STATUS_STARTED 'S'
+#define UNLOCK_STATUS_START_FAILED 'F'
+#define UNLOCK_STATUS_REJECTED 'R'
+
 /*** Function definitions ***/
 // Core functions - performHandshake, unlockCar, and startCar
 uint32_t performHandshake(void);
 void unlockCar(void);
-void startCar(void);
+uint8_t startCar(void);
 
-// Helper functions - sending ack messages
+// Helper functions - sending ack messages and the unlock trailer
 void sendAckSuccess(void);
 void sendAckFailure(void);
+void sendUnlockTrailer(uint8_t status);
+void boot_report(uint32_t ticks);
 
-// Declare Car ID
-const uint32_t car_id = CAR_ID;
+// Host bytes written before the wait for the handshake request of the unlock
+// in progress
+static uint32_t unlock_output_start;
 
 // Inter-board message encryption key
-uint8_t *message_key = MESSAGE_KEY;
+uint8_t *message_key = (uint8_t *)image_secrets.message_key;
 
 // Feature package verification key
-uint8_t *feature_verification_key = SIGNING_PUBLIC_KEY;
+uint8_t *feature_verification_key =
+    (uint8_t *)image_secrets.signing_public_key;
 
 /**
  * @brief Main function for the car example
@@ -97,11 +104,21 @@ int main(void) {
   // Initialize UART peripheral
   uart_init();
 
+  // Refuse to run from an unstamped template or a corrupted image
+  if (!image_secrets_valid()) {
+    debug_print("\r\nERROR: Secrets section not provisioned");
+    while (true)
+      ;
+  }
+
   // Initialize board link UART
-  setup_board_link();
+  setup_board_link(BOARD_LINK_MODE);
 
-  // Initialize libhydrogen
+  // Initialize libhydrogen, timing its entropy harvest on the board link timer
+  uint32_t boot_start = TimerValueGet(TIMER0_BASE, TIMER_A);
   hydro_init();
+  boot_report(boot_start - TimerValueGet(TIMER0_BASE, TIMER_A));
+  sig_cache_init();
 
   while (true) {
     unlockCar();
@@ -120,6 +137,7 @@ uint32_t performHandshake(void) {
 
   debug_print("\r\nWaiting for handshake request");
 
+  unlock_output_start = uart_host_written();
   receive_board_message_by_type(&message, HANDSHAKE_MAGIC);
 
   debug_print("\r\nHandshake request received, returning handshake packet");
@@ -173,16 +191,21 @@ void unlockCar(void) {
 
     sendAckSuccess();
 
-    startCar();
+    sendUnlockTrailer(startCar());
   } else {
     sendAckFailure();
+
+    sendUnlockTrailer(UNLOCK_STATUS_REJECTED);
   }
 }
 
 /**
  * @brief Function that handles starting of car - feature list
+ *
+ * @return uint8_t UNLOCK_STATUS_STARTED, or UNLOCK_STATUS_START_FAILED if the
+ * start message was rejected
  */
-void startCar(void) {
+uint8_t startCar(void) {
   // Create a message struct variable for receiving data
   MESSAGE_PACKET message;
   uint8_t buffer[256];
@@ -196,23 +219,32 @@ void startCar(void) {
   FEATURE_DATA *feature_info = (FEATURE_DATA *)buffer;
 
   // Verify correct car id
-  if (car_id != feature_info->car_id) {
-    return;
+  if (image_secrets.car_id != feature_info->car_id) {
+    return UNLOCK_STATUS_START_FAILED;
+  }
+
+  // num_active comes from the fob and indexes features and signatures, which
+  // hold NUM_FEATURES entries
+  if (feature_info->num_active > NUM_FEATURES) {
+    debug_print("\r\nERROR: Too many features.");
+    return UNLOCK_STATUS_START_FAILED;
   }
 
   // Verify signatures of all active features
   debug_print("\r\nBegin Feature Verification");
   ENABLE_PACKET e;
-  e.car_id = car_id;
+  e.car_id = image_secrets.car_id;
   for (int i = 0; i < feature_info->num_active; i++) {
     e.feature = feature_info->features[i];
 
     // If feature signature invalid, exit
-    if (hydro_sign_verify(feature_info->signatures[i], &e,
-                          sizeof(e.car_id) + sizeof(e.feature), "feature",
-                          feature_verification_key) != 0) {
+    // The same fob sends the same signatures every time, so after the first
+    // unlock they are cache hits
+    if (sig_cache_verify(feature_info->signatures[i], &e,
+                         sizeof(e.car_id) + sizeof(e.feature), "feature",
+                         feature_verification_key) != 0) {
       debug_print("\r\nERROR: Feature verification failed.");
-      return;
+      return UNLOCK_STATUS_START_FAILED;
     }
   }
   debug_print("\r\nFeature Verification Complete");
@@ -240,6 +272,8 @@ void startCar(void) {
   GPIOPinWrite(GPIO_PORTF_BASE, GPIO_PIN_1, 0);          // r
   GPIOPinWrite(GPIO_PORTF_BASE, GPIO_PIN_2, 0);          // b
   GPIOPinWrite(GPIO_PORTF_BASE, GPIO_PIN_3, GPIO_PIN_3); // g
+
+  return UNLOCK_STATUS_STARTED;
 }
 
 /**
@@ -277,3 +311,58 @@ void sendAckFailure(void) {
 
   send_board_message(&message);
 }
+
+/**
+ * @brief Function to write the end of unlock trailer to the host
+ *
+ * Always written, even if debug output is disabled. Builds with UNLOCK_REPORT
+ * write the stack and board link reports just before it, so that the trailer
+ * is still the last thing an unlock writes.
+ *
+ * The output length counts everything written since the car started waiting
+ * for the handshake request, debug output and reports included, so that the
+ * host can check it against what it received after flushing what came before
+ * the unlock.
+ *
+ * @param status UNLOCK_STATUS_* result of the unlock attempt
+ */
+void sendUnlockTrailer(uint8_t status) {
+#ifdef UNLOCK_REPORT
+  // Report the deepest stack use seen so far, after the deepest call path
+  stack_report();
+
+  // Report how many junk frames the board link has filtered so far
+  board_link_report();
+#endif
+
+  uint32_t output_len = uart_host_written() - unlock_output_start;
+  uint8_t len_bytes[4] = {output_len >> 24, output_len >> 16, output_len >> 8,
+                          output_len};
+  char len_hex[9];
+  hydro_bin2hex(len_hex, sizeof(len_hex), len_bytes, sizeof(len_bytes));
+
+  uart_write(HOST_UART, (uint8_t *)UNLOCK_TRAILER, strlen(UNLOCK_TRAILER));
+  uart_writeb(HOST_UART, status);
+  uart_writeb(HOST_UART, ' ');
+  uart_write(HOST_UART, (uint8_t *)len_hex, 8);
+  uart_write(HOST_UART, (uint8_t *)"\r\n", 2);
+}
+
+/**
+ * @brief Write the time hydro_init took at boot to the host UART
+ *
+ * The entropy harvest in hydro_init is most of the time from reset until the
+ * board is ready for an unlock, so this is the figure to watch when changing
+ * the boot sequence. Only written by builds with UNLOCK_REPORT, as the host
+ * tools do not expect it.
+ *
+ * @param ticks system clock ticks spent in hydro_init
+ */
+void boot_report(uint32_t ticks) {
+#ifdef UNLOCK_REPORT
+  uart_write(HOST_UART, (uint8_t *)"\r\nBoot: hydro_init ticks ", 25);
+  uart_write_hex_u32(HOST_UART, ticks);
+  uart_write(HOST_UART, (uint8_t *)" ms ", 4);
+  uart_write_hex_u32(HOST_UART, ticks / (SysCtlClockGet() / 1000));
+#endif
+}
@@ -0,0 +1,97 @@
+/**
+ * @file sig_cache.c
+ * @brief Cache of feature signatures verified since reset
+ * @date 2023
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "hydrogen.h"
+
+#include "sig_cache.h"
+
+// Digests of verified signatures, filled round-robin
+static uint8_t cache[SIG_CACHE_ENTRIES][hydro_hash_BYTES];
+static bool cache_valid[SIG_CACHE_ENTRIES];
+static uint32_t cache_next = 0;
+
+// Drawn at reset, so digests cannot be matched without it
+static uint8_t cache_key[hydro_hash_KEYBYTES];
+
+/**
+ * @brief Draw the digest key and empty the cache
+ *
+ * Must be called after hydro_init.
+ */
+void sig_cache_init(void) {
+  hydro_random_buf(cache_key, sizeof(cache_key));
+  memset(cache_valid, 0, sizeof(cache_valid));
+  cache_next = 0;
+}
+
+/**
+ * @brief Digest everything a signature verification depends on
+ *
+ * @param digest where to store the hydro_hash_BYTES digest
+ * @param signature the signature
+ * @param message the signed message
+ * @param message_len the message length
+ * @param context the signing context
+ * @param public_key the signing public key
+ */
+static void digest_inputs(uint8_t digest[hydro_hash_BYTES],
+                          const uint8_t signature[hydro_sign_BYTES],
+                          const void *message, size_t message_len,
+                          const char context[hydro_sign_CONTEXTBYTES],
+                          const uint8_t public_key[hydro_sign_PUBLICKEYBYTES]) {
+  hydro_hash_state state;
+
+  hydro_hash_init(&state, "sigcache", cache_key);
+  hydro_hash_update(&state, context, hydro_sign_CONTEXTBYTES);
+  hydro_hash_update(&state, public_key, hydro_sign_PUBLICKEYBYTES);
+  hydro_hash_update(&state, signature, hydro_sign_BYTES);
+  hydro_hash_update(&state, message, message_len);
+  hydro_hash_final(&state, digest, hydro_hash_BYTES);
+}
+
+/**
+ * @brief Verify a signature, skipping the curve arithmetic for signatures
+ * already verified since reset
+ *
+ * Takes the same arguments as hydro_sign_verify. Failed verifications are
+ * never cached, so a bad signature costs a full verification every time.
+ *
+ * @param signature the signature
+ * @param message the signed message
+ * @param message_len the message length
+ * @param context the signing context
+ * @param public_key the signing public key
+ * @return int 0 if the signature is valid, -1 if not
+ */
+int sig_cache_verify(const uint8_t signature[hydro_sign_BYTES],
+                     const void *message, size_t message_len,
+                     const char context[hydro_sign_CONTEXTBYTES],
+                     const uint8_t public_key[hydro_sign_PUBLICKEYBYTES]) {
+  uint8_t digest[hydro_hash_BYTES];
+
+  digest_inputs(digest, signature, message, message_len, context, public_key);
+
+  for (uint32_t i = 0; i < SIG_CACHE_ENTRIES; i++) {
+    if (cache_valid[i] && hydro_equal(cache[i], digest, sizeof(digest))) {
+      return 0;
+    }
+  }
+
+  if (hydro_sign_verify(signature, message, message_len, context,
+                        public_key) != 0) {
+    return -1;
+  }
+
+  memcpy(cache[cache_next], digest, sizeof(digest));
+  cache_valid[cache_next] = true;
+  cache_next = (cache_next + 1) % SIG_CACHE_ENTRIES;
+
+  return 0;
+}
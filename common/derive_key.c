@@ -0,0 +1,81 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hydrogen.h"
+
+// Must match the context used by every car and fob build in the deployment
+#define LINK_KEY_CONTEXT "linkkey_"
+
+// Derive the board link key for a car from the deployment master key.
+//
+// First arg is master key filename,
+// second is car ID.
+//
+// The key is printed bytewise in "0xXX," format for use in C headers. Passing
+// "--bench <count>" instead of a car ID derives keys for car IDs 0 to count - 1
+// and reports provisioning throughput.
+int main(int argc, char **argv) {
+  // Check args
+  if (argc < 3) {
+    fprintf(stderr, "ERROR: Must provide master key filename and car ID.\n");
+    return 1;
+  }
+
+  // Initialize libhydrogen
+  uint8_t master_key[hydro_kdf_KEYBYTES];
+  uint8_t link_key[hydro_secretbox_KEYBYTES];
+  hydro_init();
+
+  // Load master key
+  FILE *master_key_file = fopen(argv[1], "r");
+  if (master_key_file == NULL) {
+    fprintf(stderr, "ERROR: Could not open master key file.\n");
+    return 1;
+  }
+  char input_buffer[1024];
+  if (fgets(input_buffer, 1024, master_key_file) == NULL ||
+      hydro_hex2bin(master_key, hydro_kdf_KEYBYTES, input_buffer,
+                    hydro_kdf_KEYBYTES * 2, 0, 0) != hydro_kdf_KEYBYTES) {
+    fprintf(stderr, "ERROR: Malformed master key file.\n");
+    return 1;
+  }
+  fclose(master_key_file);
+
+  // Benchmark derivation of many car keys
+  if (strcmp(argv[2], "--bench") == 0) {
+    uint64_t count = argc > 3 ? strtoull(argv[3], 0, 10) : 100000;
+    uint8_t checksum = 0;
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint64_t car_id = 0; car_id < count; car_id++) {
+      hydro_kdf_derive_from_key(link_key, sizeof(link_key), car_id,
+                                LINK_KEY_CONTEXT, master_key);
+      checksum ^= link_key[0];
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double seconds =
+        (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("derived %llu keys in %.3f s (%.0f keys/s, %.2f us/key, "
+           "checksum 0x%02x)\n",
+           (unsigned long long)count, seconds, count / seconds,
+           seconds * 1e6 / count, checksum);
+    return 0;
+  }
+
+  // Derive a single car's key
+  uint32_t car_id = strtoul(argv[2], 0, 10);
+  hydro_kdf_derive_from_key(link_key, sizeof(link_key), car_id,
+                            LINK_KEY_CONTEXT, master_key);
+
+  for (int i = 0; i < hydro_secretbox_KEYBYTES; i++) {
+    printf("0x%x,", link_key[i]);
+  }
+
+  hydro_memzero(master_key, sizeof(master_key));
+  hydro_memzero(link_key, sizeof(link_key));
+}
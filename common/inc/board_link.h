@@ -0,0 +1,191 @@
+/**
+ * @file board_link.h
+ * @author Frederich Stine
+ * @brief Function that defines interface for communication between boards
+ * @date 2023
+ *
+ * This source file is part of an example system for MITRE's 2023 Embedded
+ * System CTF (eCTF). This code is being provided only for educational purposes
+ * for the 2023 MITRE eCTF competition, and may not meet MITRE standards for
+ * quality. Use this code at your own risk!
+ *
+ * @copyright Copyright (c) 2023 The MITRE Corporation
+ */
+
+#ifndef BOARD_LINK_H
+#define BOARD_LINK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "inc/hw_memmap.h"
+
+#include "hydrogen.h"
+
+#include "feature_list.h"
+
+#define ACK_SUCCESS 1
+#define ACK_FAIL 0
+
+#define HANDSHAKE_MAGIC 0x53
+#define ACK_MAGIC 0x54
+#define PAIR_MAGIC 0x55
+#define UNLOCK_MAGIC 0x56
+#define START_MAGIC 0x57
+#define LINK_ACK_MAGIC 0x58
+#define BOARD_UART ((uint32_t)UART1_BASE)
+
+#define MESSAGE_MAX_LENGTH (uint8_t)255
+
+// Frames are the magic, a sequence number, the message length, the message
+// (encrypted, except for pairing messages) and a little-endian CRC-16 of all
+// of those. They are COBS-encoded and sent between delimiters, so that the
+// receiver can find the next frame after lost or corrupted bytes. Every data
+// frame is answered with an empty LINK_ACK_MAGIC frame holding its sequence
+// number, and retransmitted until it is.
+#define FRAME_DELIMITER 0x00
+#define FRAME_OVERHEAD 5
+#define FRAME_MAX_LENGTH                                                       \
+  (FRAME_OVERHEAD + hydro_secretbox_HEADERBYTES + MESSAGE_MAX_LENGTH)
+
+// In LINK_MODE_FEC, Reed-Solomon parity (see fec.h) is added to frames before
+// COBS, so that a few bad bytes are fixed in place instead of costing a
+// retransmission. Both boards must use the same mode.
+#define LINK_MODE_ARQ 0
+#define LINK_MODE_FEC 1
+
+// The mode the firmware sets up, chosen at build time
+#ifndef BOARD_LINK_MODE
+#define BOARD_LINK_MODE LINK_MODE_ARQ
+#endif
+
+// The board this code is built for, chosen at build time. Each board only
+// accepts the message types it receives, so frames of the other board's
+// messages are dropped as noise. BOARD_ROLE_ANY accepts every message type,
+// for the benchmarks that play both boards.
+#define BOARD_ROLE_ANY 0
+#define BOARD_ROLE_CAR 1
+#define BOARD_ROLE_FOB 2
+
+#ifndef BOARD_ROLE
+#define BOARD_ROLE BOARD_ROLE_ANY
+#endif
+
+/**
+ * @brief Structure for message between boards
+ *
+ */
+typedef struct {
+  uint8_t magic;
+  uint8_t message_len;
+  uint8_t *buffer;
+} MESSAGE_PACKET;
+
+// Defines a struct for the format of a pairing message
+typedef struct {
+  uint32_t car_id;
+  uint8_t pin[8];
+  uint8_t message_key[hydro_secretbox_KEYBYTES];
+} PAIR_PACKET;
+
+// Defines a struct for the format of start message
+typedef struct {
+  uint32_t car_id;
+  uint8_t num_active;
+  uint8_t features[NUM_FEATURES];
+  uint8_t signatures[NUM_FEATURES][hydro_sign_BYTES];
+} FEATURE_DATA;
+
+/**
+ * @brief A message encrypted ahead of time, waiting to be sent once
+ */
+typedef struct {
+  uint8_t frame[FRAME_MAX_LENGTH]; // raw frame without sequence number or CRC
+  uint32_t body_len;
+  bool ready; // false once sent, or if the message has changed
+} PREPARED_MESSAGE;
+
+/**
+ * @brief Counters of the frames received while waiting for one message type
+ *
+ * Everything but accepted frames is rejected before decryption, except for
+ * bad_mac.
+ */
+typedef struct {
+  uint32_t accepted;   // frames of the awaited type that were decrypted
+  uint32_t bad_frame;  // malformed frames, bad CRCs and unknown magics
+  uint32_t bad_length; // lengths out of bounds for the magic or frame size
+  uint32_t unexpected; // valid frames of another type, skipped undecrypted
+  uint32_t bad_mac;    // frames of the awaited type that failed decryption
+  uint32_t duplicate;  // retransmissions of a frame already received
+  uint32_t corrected;  // frames with bad bytes fixed by LINK_MODE_FEC
+} LINK_STATS;
+
+/**
+ * @brief Counters of the data frames sent
+ */
+typedef struct {
+  uint32_t sent;        // messages sent
+  uint32_t retransmits; // frames sent again after no link ack came in time
+  uint32_t gave_up;     // messages never acked, after every retransmission
+} ARQ_STATS;
+
+/**
+ * @brief Set the up board link object
+ *
+ * UART 1 is used to communicate between boards
+ *
+ * @param mode LINK_MODE_ARQ or LINK_MODE_FEC, the same on both boards
+ */
+void setup_board_link(uint8_t mode);
+
+/**
+ * @brief Send an encrypted message between boards
+ *
+ * @param message pointer to message to send
+ * @return uint32_t the number of bytes sent, or 0 if the frame was never acked
+ */
+uint32_t send_board_message(MESSAGE_PACKET *message);
+
+/**
+ * @brief Encrypt a message now, to be sent later with send_prepared_message
+ *
+ * @param prepared where to keep the encrypted frame
+ * @param message the message to send
+ */
+void prepare_board_message(PREPARED_MESSAGE *prepared,
+                           MESSAGE_PACKET *message);
+
+/**
+ * @brief Send a message encrypted by prepare_board_message, once
+ *
+ * @param prepared the prepared message
+ * @return uint32_t the number of bytes sent, or 0 if the frame was never acked
+ */
+uint32_t send_prepared_message(PREPARED_MESSAGE *prepared);
+
+/**
+ * @brief Receive an encrypted message between boards
+ *
+ * @param message pointer to message where data will be received
+ * @return uint32_t the number of bytes received - 0 for a frame that was
+ * rejected before decryption, -1 for corrupted or tampered message
+ */
+uint32_t receive_board_message(MESSAGE_PACKET *message);
+
+/**
+ * @brief Function that retreives messages until the specified message is found
+ *
+ * @param message pointer to message where data will be received
+ * @param type the type of message to receive
+ * @return uint32_t the number of bytes received
+ */
+uint32_t receive_board_message_by_type(MESSAGE_PACKET *message, uint8_t type);
+
+/**
+ * @brief Write the frame counters of every receive state and the
+ * retransmission counters to the host UART
+ */
+void board_link_report(void);
+
+#endif
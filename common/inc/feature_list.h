@@ -21,4 +21,9 @@
 #define FEATURE_END 0x7C0
 #define FEATURE_SIZE 64
 
+// Binary feature packages start with this byte, followed by a version byte
+// and a length byte. It can never start a legacy hex package.
+#define PACKAGE_BINARY_MAGIC 0xFE
+#define PACKAGE_VERSION 1
+
 #endif
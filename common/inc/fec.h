@@ -0,0 +1,57 @@
+/**
+ * @file fec.h
+ * @brief Reed-Solomon forward error correction for board link frames
+ * @date 2023
+ *
+ * Frames are split into blocks of up to FEC_BLOCK_DATA bytes, and each block
+ * is followed by FEC_BLOCK_PARITY parity bytes of a Reed-Solomon code over
+ * GF(2^8). Up to FEC_MAX_ERRORS bad bytes anywhere in a block, parity
+ * included, are corrected in place. The last block is shortened rather than
+ * padded, so the coded length gives the frame length back.
+ */
+
+#ifndef FEC_H
+#define FEC_H
+
+#include <stdint.h>
+
+#define FEC_BLOCK_DATA 32
+#define FEC_BLOCK_PARITY 8
+#define FEC_MAX_ERRORS (FEC_BLOCK_PARITY / 2)
+
+// Coded length of a frame of the given length
+#define FEC_CODED_LENGTH(length)                                               \
+  ((length) + FEC_BLOCK_PARITY * (((length) + FEC_BLOCK_DATA - 1) /            \
+                                  FEC_BLOCK_DATA))
+
+/**
+ * @brief Build the GF(2^8) tables and the generator polynomial
+ *
+ * Must be called before fec_encode or fec_decode.
+ */
+void fec_init(void);
+
+/**
+ * @brief Add parity to every block of a frame
+ *
+ * @param coded where to store the coded frame, FEC_CODED_LENGTH(length) bytes
+ * @param frame the frame
+ * @param length the frame length
+ * @return uint32_t the coded length
+ */
+uint32_t fec_encode(uint8_t *coded, const uint8_t *frame, uint32_t length);
+
+/**
+ * @brief Correct a coded frame and strip its parity
+ *
+ * @param frame where to store the frame, may be the same buffer as coded
+ * @param coded the coded frame, corrected in place
+ * @param coded_len the coded length
+ * @param corrected set to the number of bytes corrected
+ * @return int32_t the frame length, or -1 if a block has too many bad bytes
+ * or the coded length is impossible
+ */
+int32_t fec_decode(uint8_t *frame, uint8_t *coded, uint32_t coded_len,
+                   uint32_t *corrected);
+
+#endif // FEC_H
@@ -0,0 +1,52 @@
+/**
+ * @file secrets_section.h
+ * @brief Layout of the per-device secrets section
+ * @date 2023
+ *
+ * The secrets are placed in the .secrets section at a fixed offset from the
+ * start of the image (see firmware.ld). The layout is shared by car and fob
+ * images and must match SECRETS_FORMAT in scripts/stamp_secrets.py, which
+ * patches the section of a prebuilt template image.
+ */
+
+#ifndef SECRETS_SECTION_H
+#define SECRETS_SECTION_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hydrogen.h"
+
+#define SECRETS_MAGIC 0x53435254 // "TRCS" in little-endian memory order
+#define SECRETS_VERSION 1
+#define SECRETS_PIN_SIZE 8
+
+/**
+ * @brief Structure of the secrets section
+ *
+ * checksum is the CRC-32 of every preceding field.
+ */
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t car_id;
+  uint32_t paired;
+  uint8_t pair_pin[SECRETS_PIN_SIZE];
+  uint8_t message_key[hydro_secretbox_KEYBYTES];
+  uint8_t signing_public_key[hydro_sign_PUBLICKEYBYTES];
+  uint32_t checksum;
+} IMAGE_SECRETS;
+
+// Defined in the generated secrets.h, included only by secrets_section.c.
+// Volatile so the compiler can never fold in the template's placeholder values.
+extern const volatile IMAGE_SECRETS image_secrets;
+
+/**
+ * @brief Check that the secrets section has been provisioned
+ *
+ * @return true if the magic, version and checksum are correct
+ * @return false for an unstamped template or a corrupted image
+ */
+bool image_secrets_valid(void);
+
+#endif // SECRETS_SECTION_H
@@ -0,0 +1,38 @@
+/**
+ * @file stack.h
+ * @brief Stack usage measurement
+ * @date 2023
+ *
+ * The startup code paints the whole application stack with
+ * STACK_PAINT_PATTERN before calling main. The deepest word that no longer
+ * holds the pattern marks the stack high-water mark.
+ */
+
+#ifndef STACK_H
+#define STACK_H
+
+#include <stdint.h>
+
+// Must match the pattern written by Firmware_Startup in startup_gcc.c
+#define STACK_PAINT_PATTERN 0xC5C5C5C5
+
+/**
+ * @brief Get the total size of the application stack
+ *
+ * @return uint32_t size of the stack reserved by the linker script in bytes
+ */
+uint32_t stack_size(void);
+
+/**
+ * @brief Get the maximum stack depth reached since reset
+ *
+ * @return uint32_t number of stack bytes that have been used
+ */
+uint32_t stack_high_water_mark(void);
+
+/**
+ * @brief Write the stack high-water mark and stack size to the host UART
+ */
+void stack_report(void);
+
+#endif // STACK_H
@@ -22,6 +22,10 @@
 
 #define HOST_UART ((uint32_t)UART0_BASE)
 
+// Bytes received by the interrupt handler of each UART and not yet read, a
+// power of two. Holds a whole board link frame, or 44 ms at 115200 baud.
+#define UART_RX_BUFFER_SIZE 512
+
 /**
  * @brief Initialize the UART interfaces.
  *
@@ -29,6 +33,28 @@
  */
 void uart_init(void);
 
+/**
+ * @brief Receive a UART's bytes into a buffer from its interrupt handler.
+ *
+ * @param uart is the base address of the UART port, UART 0 or UART 1.
+ */
+void uart_enable_rx_interrupt(uint32_t uart);
+
+/**
+ * @brief Count the received bytes lost on a UART.
+ *
+ * @param uart is the base address of the UART port.
+ * @return the bytes dropped because its FIFO or buffer was full.
+ */
+uint32_t uart_rx_overruns(uint32_t uart);
+
+/**
+ * @brief Count the bytes written to the host UART.
+ *
+ * @return the bytes written to the host UART since boot, wrapping at 2^32.
+ */
+uint32_t uart_host_written(void);
+
 /**
  * @brief Check if there are characters available on a UART interface.
  *
@@ -83,4 +109,12 @@ void uart_writeb(uint32_t uart, uint8_t data);
  */
 uint32_t uart_write(uint32_t uart, uint8_t *buf, uint32_t len);
 
+/**
+ * @brief Write a 32-bit value to a UART interface as "0x" and 8 hex digits.
+ *
+ * @param uart is the base address of the UART port to write to.
+ * @param value is the value to write.
+ */
+void uart_write_hex_u32(uint32_t uart, uint32_t value);
+
 #endif // UART_H
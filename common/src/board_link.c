@@ -0,0 +1,767 @@
+/**
+ * @file board_link.h
+ * @author Frederich Stine
+ * @brief Firmware UART interface implementation.
+ * @date 2023
+ *
+ * This source file is part of an example system for MITRE's 2023 Embedded
+ * System CTF (eCTF). This code is being provided only for educational purposes
+ * for the 2023 MITRE eCTF competition, and may not meet MITRE standards for
+ * quality. Use this code at your own risk!
+ *
+ * @copyright Copyright (c) 2023 The MITRE Corporation
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+#include "inc/hw_uart.h"
+
+#include "driverlib/gpio.h"
+#include "driverlib/pin_map.h"
+#include "driverlib/sw_crc.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/timer.h"
+#include "driverlib/uart.h"
+
+#include "board_link.h"
+#include "debug.h"
+#include "fec.h"
+#include "uart.h"
+
+#include "hydrogen.h"
+
+extern uint8_t *message_key;
+
+/**
+ * @brief Plaintext length bounds of a message type
+ */
+typedef struct {
+  uint8_t magic;
+  uint8_t min_len;
+  uint8_t max_len;
+} FRAME_TYPE;
+
+// Every message type this board receives. Frames with any other magic, or
+// with a length outside these bounds, are noise and are never decrypted.
+// Messages received into a structure are exactly its size, so that no frame
+// can write past it.
+static const FRAME_TYPE frame_types[] = {
+    {HANDSHAKE_MAGIC, 0, 4}, // empty request, nonce response
+#if BOARD_ROLE != BOARD_ROLE_CAR
+    {ACK_MAGIC, 1, 1},
+    {PAIR_MAGIC, sizeof(PAIR_PACKET), sizeof(PAIR_PACKET)},
+#endif
+#if BOARD_ROLE != BOARD_ROLE_FOB
+    {UNLOCK_MAGIC, 4, 4},
+    {START_MAGIC, sizeof(FEATURE_DATA), sizeof(FEATURE_DATA)},
+#endif
+};
+
+#define NUM_FRAME_TYPES (sizeof(frame_types) / sizeof(frame_types[0]))
+
+// Frame counters for each awaited message type, and for frames received by
+// receive_board_message or while waiting for a link ack
+static LINK_STATS link_stats[NUM_FRAME_TYPES + 1];
+
+// receive_frame_bytes results besides a frame length
+#define FRAME_MALFORMED -1
+#define FRAME_TIMEOUT -2
+
+// Retransmission timeout bounds, and retransmissions before giving up
+#define LINK_RTO_INITIAL_MS 50
+#define LINK_RTO_MIN_MS 10
+#define LINK_RTO_MAX_MS 1000
+#define LINK_MAX_RETRANSMITS 6
+
+// Sequence number of the last data frame sent, random from boot so that a
+// restarted board's first frame is not mistaken for a retransmission
+static uint8_t tx_seq;
+static bool tx_seq_valid = false;
+
+// Sequence number of every handshake request, which no other data frame uses.
+// A handshake request starts an unlock, and both boards number the frames of
+// the unlock from it. A restarted or resumed fob's request can then never
+// match the last frame of the previous unlock, which the car still holds as
+// rx_seq, and a restarted car's reply is numbered after the request.
+#define SESSION_START_SEQ 0
+
+// Sequence number of the last data frame received, -1 before the first
+static int32_t rx_seq = -1;
+
+// A data frame that arrived while waiting for a link ack, already acked
+static uint8_t pending_frame[FRAME_MAX_LENGTH];
+static int32_t pending_len = 0;
+
+// Smoothed round trip time and its variation, and the resulting timeout
+static uint32_t srtt_ms = 0;
+static uint32_t rttvar_ms = 0;
+static uint32_t rto_ms = LINK_RTO_INITIAL_MS;
+
+static ARQ_STATS arq_stats;
+
+// Timer 0 counts down through its full 32 bits at the system clock
+static uint32_t timer_ticks_per_ms;
+
+// LINK_MODE_ARQ, or LINK_MODE_FEC to send and expect parity on every frame
+static uint8_t link_mode = LINK_MODE_ARQ;
+
+// A frame with its parity, between coding and COBS. Sending and receiving
+// never overlap, so they share it.
+#define FEC_FRAME_MAX_LENGTH FEC_CODED_LENGTH(FRAME_MAX_LENGTH)
+static uint8_t coded_frame[FEC_FRAME_MAX_LENGTH];
+
+/**
+ * @brief Set the up board link object
+ *
+ * UART 1 is used to communicate between boards, and timer 0 times link acks
+ *
+ * @param mode LINK_MODE_ARQ or LINK_MODE_FEC, the same on both boards
+ */
+void setup_board_link(uint8_t mode) {
+  link_mode = mode;
+  if (link_mode == LINK_MODE_FEC) {
+    fec_init();
+  }
+
+  SysCtlPeripheralEnable(SYSCTL_PERIPH_UART1);
+  SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOB);
+  SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER0);
+
+  GPIOPinConfigure(GPIO_PB0_U1RX);
+  GPIOPinConfigure(GPIO_PB1_U1TX);
+
+  GPIOPinTypeUART(GPIO_PORTB_BASE, GPIO_PIN_0 | GPIO_PIN_1);
+
+  // Configure the UART for 115,200, 8-N-1 operation.
+  UARTConfigSetExpClk(
+      BOARD_UART, SysCtlClockGet(), 115200,
+      (UART_CONFIG_WLEN_8 | UART_CONFIG_STOP_ONE | UART_CONFIG_PAR_NONE));
+
+  TimerConfigure(TIMER0_BASE, TIMER_CFG_PERIODIC);
+  TimerLoadSet(TIMER0_BASE, TIMER_A, 0xFFFFFFFF);
+  TimerEnable(TIMER0_BASE, TIMER_A);
+  timer_ticks_per_ms = SysCtlClockGet() / 1000;
+
+  uart_enable_rx_interrupt(BOARD_UART);
+  while (uart_avail(BOARD_UART)) {
+    uart_readb(BOARD_UART);
+  }
+
+  // Start over as after a reset, with no sequence numbers seen or sent
+  tx_seq_valid = false;
+  rx_seq = -1;
+  pending_len = 0;
+}
+
+/**
+ * @brief Milliseconds since a timer 0 reading
+ *
+ * @param start the timer 0 value to measure from
+ * @return uint32_t the elapsed milliseconds
+ */
+static uint32_t elapsed_ms(uint32_t start) {
+  return (start - TimerValueGet(TIMER0_BASE, TIMER_A)) / timer_ticks_per_ms;
+}
+
+/**
+ * @brief Whether a raw data frame is a handshake request, which starts an
+ * unlock
+ *
+ * @param frame the raw frame
+ * @return bool true for an empty HANDSHAKE_MAGIC frame
+ */
+static bool is_session_start(const uint8_t *frame) {
+  return frame[0] == HANDSHAKE_MAGIC && frame[2] == 0;
+}
+
+/**
+ * @brief Find the protocol definition of a message type
+ *
+ * @param magic the message type
+ * @return int32_t index into frame_types, or -1 if not a protocol message
+ */
+static int32_t frame_type_index(uint8_t magic) {
+  for (uint32_t i = 0; i < NUM_FRAME_TYPES; i++) {
+    if (frame_types[i].magic == magic) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/**
+ * @brief COBS-encode a frame onto the board link between two delimiters
+ *
+ * Each block of up to 254 non-zero bytes is sent after a code byte holding
+ * its length plus one. A code below 0xFF stands for a zero after the block,
+ * so the delimiter never appears inside an encoded frame. The leading
+ * delimiter ends any noise sent before the frame. In LINK_MODE_FEC, the
+ * parity is added before COBS, so that a bad byte on the line is still one
+ * bad byte after decoding.
+ *
+ * @param frame the raw frame
+ * @param length the raw frame length
+ */
+static void send_frame(const uint8_t *frame, uint32_t length) {
+  uint32_t start = 0;
+
+  if (link_mode == LINK_MODE_FEC) {
+    length = fec_encode(coded_frame, frame, length);
+    frame = coded_frame;
+  }
+
+  UARTCharPut(BOARD_UART, FRAME_DELIMITER);
+
+  while (true) {
+    uint32_t end = start;
+    while (end < length && frame[end] != 0 && end - start < 254) {
+      end++;
+    }
+
+    UARTCharPut(BOARD_UART, end - start + 1);
+    for (uint32_t i = start; i < end; i++) {
+      UARTCharPut(BOARD_UART, frame[i]);
+    }
+
+    if (end == length) {
+      break;
+    }
+
+    // Skip the zero stood for by the code byte, full blocks have none
+    start = (end - start == 254) ? end : end + 1;
+  }
+
+  UARTCharPut(BOARD_UART, FRAME_DELIMITER);
+}
+
+/**
+ * @brief Add the CRC to a raw frame and send it
+ *
+ * @param frame the raw frame, with room for the CRC
+ * @param length the raw frame length without the CRC
+ */
+static void send_checked_frame(uint8_t *frame, uint32_t length) {
+  uint16_t crc = Crc16(0, frame, length);
+  frame[length] = crc & 0xFF;
+  frame[length + 1] = crc >> 8;
+
+  send_frame(frame, length + 2);
+}
+
+/**
+ * @brief Acknowledge a data frame at the link layer
+ *
+ * Link acks are not encrypted. A forged one can only stop a retransmission,
+ * which an attacker on the link can already do by corrupting the frame.
+ *
+ * @param seq the data frame's sequence number
+ */
+static void send_link_ack(uint8_t seq) {
+  uint8_t frame[FRAME_OVERHEAD] = {LINK_ACK_MAGIC, seq, 0};
+
+  send_checked_frame(frame, FRAME_OVERHEAD - 2);
+}
+
+/**
+ * @brief Read and COBS-decode bytes up to the next delimiter
+ *
+ * Decoding happens as bytes arrive, so a frame costs one pass. A frame that
+ * is too long or ends mid-block is read to its delimiter and reported as
+ * malformed, which is how the receiver resynchronizes after lost, extra or
+ * corrupted bytes.
+ *
+ * @param frame where to store the decoded frame
+ * @param max_len the size of frame
+ * @param start timer 0 value the timeout counts from
+ * @param timeout_ms how long to wait for a delimiter, or 0 to wait forever
+ * @return int32_t the decoded length, FRAME_MALFORMED or FRAME_TIMEOUT
+ */
+static int32_t receive_frame_bytes(uint8_t *frame, uint32_t max_len,
+                                   uint32_t start, uint32_t timeout_ms) {
+  uint32_t length = 0;
+  uint32_t remaining = 0;
+  bool pending_zero = false;
+  bool malformed = false;
+
+  while (true) {
+    while (timeout_ms != 0 && !uart_avail(BOARD_UART)) {
+      if (elapsed_ms(start) >= timeout_ms) {
+        return FRAME_TIMEOUT;
+      }
+    }
+
+    uint8_t byte = (uint8_t)uart_readb(BOARD_UART);
+
+    if (byte == FRAME_DELIMITER) {
+      // The zero stood for by the last code byte is not part of the frame
+      return (malformed || remaining != 0) ? FRAME_MALFORMED : (int32_t)length;
+    }
+
+    if (remaining == 0) {
+      if (pending_zero) {
+        if (length == max_len) {
+          malformed = true;
+        } else {
+          frame[length++] = 0;
+        }
+      }
+      pending_zero = (byte != 0xFF);
+      remaining = byte - 1;
+    } else {
+      if (length == max_len) {
+        malformed = true;
+      } else {
+        frame[length++] = byte;
+      }
+      remaining--;
+    }
+  }
+}
+
+/**
+ * @brief Receive the next link ack or new, well-formed data frame
+ *
+ * Data frames are acked as soon as they pass their CRC and length checks, so
+ * the sender stops retransmitting before the frame is decrypted. A
+ * retransmission of the last data frame is acked again but not returned.
+ *
+ * In LINK_MODE_FEC, bad bytes are corrected before any of the checks.
+ *
+ * @param frame where to store the frame, FRAME_MAX_LENGTH bytes
+ * @param start timer 0 value the timeout counts from
+ * @param timeout_ms how long to wait, or 0 to wait forever
+ * @param stats counters to update
+ * @return int32_t the frame length, 0 for a dropped frame, or FRAME_TIMEOUT
+ */
+static int32_t receive_link_frame(uint8_t *frame, uint32_t start,
+                                  uint32_t timeout_ms, LINK_STATS *stats) {
+  bool fec = link_mode == LINK_MODE_FEC;
+  int32_t frame_len;
+
+  // Back-to-back delimiters leave empty frames, which carry nothing
+  do {
+    frame_len = fec ? receive_frame_bytes(coded_frame, FEC_FRAME_MAX_LENGTH,
+                                          start, timeout_ms)
+                    : receive_frame_bytes(frame, FRAME_MAX_LENGTH, start,
+                                          timeout_ms);
+  } while (frame_len == 0);
+
+  if (frame_len == FRAME_TIMEOUT) {
+    return FRAME_TIMEOUT;
+  }
+
+  if (fec && frame_len > 0) {
+    uint32_t corrected;
+
+    frame_len = fec_decode(frame, coded_frame, frame_len, &corrected);
+    if (frame_len > 0 && corrected) {
+      stats->corrected++;
+    }
+  }
+
+  if (frame_len < FRAME_OVERHEAD ||
+      Crc16(0, frame, frame_len - 2) !=
+          (frame[frame_len - 2] | (frame[frame_len - 1] << 8))) {
+    stats->bad_frame++;
+    return 0;
+  }
+
+  if (frame[0] == LINK_ACK_MAGIC) {
+    return frame_len == FRAME_OVERHEAD ? frame_len : 0;
+  }
+
+  int32_t index = frame_type_index(frame[0]);
+  if (index < 0) {
+    stats->bad_frame++;
+    return 0;
+  }
+
+  uint32_t body_len = frame[2];
+  if (frame[0] != PAIR_MAGIC) {
+    body_len += hydro_secretbox_HEADERBYTES;
+  }
+
+  if (frame[2] < frame_types[index].min_len ||
+      frame[2] > frame_types[index].max_len ||
+      frame_len != FRAME_OVERHEAD + body_len) {
+    stats->bad_length++;
+    return 0;
+  }
+
+  send_link_ack(frame[1]);
+
+  if (frame[1] == rx_seq) {
+    stats->duplicate++;
+    return 0;
+  }
+  rx_seq = frame[1];
+
+  // The other board started an unlock, number the reply after its request
+  if (is_session_start(frame)) {
+    tx_seq = SESSION_START_SEQ;
+    tx_seq_valid = true;
+  }
+
+  return frame_len;
+}
+
+/**
+ * @brief Wait for the link ack of the last data frame sent
+ *
+ * A new data frame from the other board also means that it got the frame,
+ * since the protocol only sends a message in response to the previous one.
+ * It is kept for the next receive.
+ *
+ * @param start timer 0 value of when the frame was sent
+ * @param timeout_ms how long to wait
+ * @return bool true if the frame got through, false on timeout
+ */
+static bool wait_for_link_ack(uint32_t start, uint32_t timeout_ms) {
+  LINK_STATS *stats = &link_stats[NUM_FRAME_TYPES];
+  uint8_t frame[FRAME_MAX_LENGTH];
+
+  if (pending_len) {
+    return true;
+  }
+
+  while (true) {
+    int32_t frame_len = receive_link_frame(frame, start, timeout_ms, stats);
+
+    if (frame_len == FRAME_TIMEOUT) {
+      return false;
+    } else if (frame_len == 0) {
+      continue;
+    } else if (frame[0] != LINK_ACK_MAGIC) {
+      memcpy(pending_frame, frame, frame_len);
+      pending_len = frame_len;
+      return true;
+    } else if (frame[1] == tx_seq) {
+      return true;
+    }
+  }
+}
+
+/**
+ * @brief Update the retransmission timeout with a round trip time sample
+ *
+ * Smoothed as in TCP (RFC 6298), in whole milliseconds.
+ *
+ * @param rtt_ms the measured round trip time
+ */
+static void update_rto(uint32_t rtt_ms) {
+  if (srtt_ms == 0 && rttvar_ms == 0) {
+    srtt_ms = rtt_ms;
+    rttvar_ms = rtt_ms / 2;
+  } else {
+    uint32_t delta = srtt_ms > rtt_ms ? srtt_ms - rtt_ms : rtt_ms - srtt_ms;
+    rttvar_ms = (3 * rttvar_ms + delta) / 4;
+    srtt_ms = (7 * srtt_ms + rtt_ms) / 8;
+  }
+
+  rto_ms = srtt_ms + 4 * rttvar_ms;
+  if (rto_ms < LINK_RTO_MIN_MS) {
+    rto_ms = LINK_RTO_MIN_MS;
+  } else if (rto_ms > LINK_RTO_MAX_MS) {
+    rto_ms = LINK_RTO_MAX_MS;
+  }
+}
+
+/**
+ * @brief Fill in the type, length and body of a data frame
+ *
+ * @param frame the raw frame, FRAME_MAX_LENGTH bytes
+ * @param message the message to send
+ * @return uint32_t the body length
+ */
+static uint32_t build_data_frame(uint8_t *frame, MESSAGE_PACKET *message) {
+  frame[0] = message->magic;
+  frame[2] = message->message_len;
+
+  // If message is a pairing packet, send unencrypted. Otherwise, encrypt
+  // message.
+  if (message->magic == PAIR_MAGIC) {
+    debug_print("\r\nSending unencrypted pairing message");
+
+    memcpy(&frame[3], message->buffer, message->message_len);
+    return message->message_len;
+  }
+
+  const char context[] = "boardmsg";
+
+  /* debug_print("\r\nEncrypting message contents"); */
+
+  hydro_secretbox_encrypt(&frame[3], message->buffer, message->message_len, 0,
+                          context, message_key);
+  return hydro_secretbox_HEADERBYTES + message->message_len;
+}
+
+/**
+ * @brief Number a built data frame and send it until it is acked
+ *
+ * The frame is retransmitted until the other board acks it, with the timeout
+ * doubling after each try, up to LINK_MAX_RETRANSMITS times.
+ *
+ * @param frame the raw frame, with room for the CRC
+ * @param body_len the body length
+ * @return uint32_t the body length, or 0 if the frame was never acked
+ */
+static uint32_t send_data_frame(uint8_t *frame, uint32_t body_len) {
+  if (is_session_start(frame)) {
+    // Frames still to come from the other board belong to the last unlock
+    tx_seq = SESSION_START_SEQ;
+    rx_seq = -1;
+  } else {
+    if (!tx_seq_valid) {
+      tx_seq = hydro_random_u32();
+    }
+    tx_seq++;
+    if (tx_seq == SESSION_START_SEQ) {
+      tx_seq++;
+    }
+  }
+  tx_seq_valid = true;
+
+  frame[1] = tx_seq;
+
+  arq_stats.sent++;
+
+  uint32_t timeout_ms = rto_ms;
+  for (uint32_t attempt = 0; attempt <= LINK_MAX_RETRANSMITS; attempt++) {
+    if (attempt) {
+      arq_stats.retransmits++;
+      send_frame(frame, FRAME_OVERHEAD + body_len);
+    } else {
+      send_checked_frame(frame, FRAME_OVERHEAD - 2 + body_len);
+    }
+
+    uint32_t start = TimerValueGet(TIMER0_BASE, TIMER_A);
+    bool had_pending = pending_len != 0;
+
+    if (wait_for_link_ack(start, timeout_ms)) {
+      // Only a first try gives an unambiguous round trip time (Karn)
+      if (attempt == 0 && !had_pending && pending_len == 0) {
+        update_rto(elapsed_ms(start));
+      }
+
+      /* debug_print("\r\nMessage sent"); */
+
+      return body_len;
+    }
+
+    timeout_ms *= 2;
+    if (timeout_ms > LINK_RTO_MAX_MS) {
+      timeout_ms = LINK_RTO_MAX_MS;
+    }
+  }
+
+  debug_print("\r\nERROR: Board message not acknowledged");
+  arq_stats.gave_up++;
+
+  // Back off for the next message, the other board may have gone away
+  rto_ms = timeout_ms;
+
+  return 0;
+}
+
+/**
+ * @brief Send an encrypted message between boards
+ *
+ * @param message pointer to message to send
+ * @return uint32_t the number of bytes sent, or 0 if the frame was never acked
+ */
+uint32_t send_board_message(MESSAGE_PACKET *message) {
+  uint8_t frame[FRAME_MAX_LENGTH];
+
+  debug_print("\r\nSending board message");
+
+  return send_data_frame(frame, build_data_frame(frame, message));
+}
+
+/**
+ * @brief Encrypt a message now, to be sent later with send_prepared_message
+ *
+ * @param prepared where to keep the encrypted frame
+ * @param message the message to send
+ */
+void prepare_board_message(PREPARED_MESSAGE *prepared,
+                           MESSAGE_PACKET *message) {
+  prepared->body_len = build_data_frame(prepared->frame, message);
+  prepared->ready = true;
+}
+
+/**
+ * @brief Send a message encrypted by prepare_board_message
+ *
+ * Only the sequence number and CRC are left to fill in. The prepared frame is
+ * used up, so that no ciphertext is ever sent twice as a new message.
+ *
+ * @param prepared the prepared message
+ * @return uint32_t the number of bytes sent, or 0 if the frame was never acked
+ */
+uint32_t send_prepared_message(PREPARED_MESSAGE *prepared) {
+  debug_print("\r\nSending prepared board message");
+
+  prepared->ready = false;
+  return send_data_frame(prepared->frame, prepared->body_len);
+}
+
+/**
+ * @brief Receive one frame, rejecting it as cheaply as possible
+ *
+ * @param message pointer to message where data will be received
+ * @param type the awaited message type, or 0 to accept any type
+ * @param stats counters to update
+ * @return int32_t 1 for an accepted message, 0 for a frame that was rejected
+ * before decryption, -1 for corrupted or tampered message
+ */
+static int32_t receive_frame(MESSAGE_PACKET *message, uint8_t type,
+                             LINK_STATS *stats) {
+  uint8_t frame[FRAME_MAX_LENGTH];
+  int32_t frame_len;
+
+  if (pending_len) {
+    memcpy(frame, pending_frame, pending_len);
+    frame_len = pending_len;
+    pending_len = 0;
+  } else {
+    frame_len = receive_link_frame(frame, 0, 0, stats);
+  }
+
+  // Dropped frames, and link acks that came after their frame was given up
+  if (frame_len == 0 || frame[0] == LINK_ACK_MAGIC) {
+    return 0;
+  }
+
+  message->magic = frame[0];
+  message->message_len = frame[2];
+
+  uint32_t body_len = frame_len - FRAME_OVERHEAD;
+
+  // A real frame, but not the one this state is waiting for
+  if (type != 0 && message->magic != type) {
+    stats->unexpected++;
+    return 0;
+  }
+
+  if (message->magic == PAIR_MAGIC) {
+    /* debug_print("\r\nReceiving unencrypted pairing message"); */
+
+    memcpy(message->buffer, &frame[3], message->message_len);
+  } else {
+    const char context[] = "boardmsg";
+
+    /* debug_print("\r\nDecrypting board message"); */
+
+    if (hydro_secretbox_decrypt(message->buffer, &frame[3], body_len, 0,
+                                context, message_key)) {
+      debug_print("\r\nERROR: Invalid message received");
+      stats->bad_mac++;
+      return -1;
+    }
+
+    /* debug_print("\r\nMessage received"); */
+  }
+
+  stats->accepted++;
+  return 1;
+}
+
+/**
+ * @brief Receive an encrypted message between boards
+ *
+ * @param message pointer to message where data will be received
+ * @return uint32_t the number of bytes received - 0 for a frame that was
+ * rejected before decryption, -1 for corrupted or tampered message
+ */
+uint32_t receive_board_message(MESSAGE_PACKET *message) {
+  int32_t result = receive_frame(message, 0, &link_stats[NUM_FRAME_TYPES]);
+
+  return result == 1 ? message->message_len : (uint32_t)result;
+}
+
+/**
+ * @brief Function that retreives messages until the specified message is found
+ *
+ * Frames of other types are skipped without being decrypted, so line noise or
+ * a flood of stale frames costs little more than reading them.
+ *
+ * @param message pointer to message where data will be received
+ * @param type the type of message to receive
+ * @return uint32_t the number of bytes received
+ */
+uint32_t receive_board_message_by_type(MESSAGE_PACKET *message, uint8_t type) {
+  int32_t index = frame_type_index(type);
+  LINK_STATS *stats = &link_stats[index < 0 ? NUM_FRAME_TYPES : index];
+
+  while (receive_frame(message, type, stats) != 1)
+    ;
+
+  debug_print("\r\nReceived msg with magic: 0x");
+  char magic[8];
+  hydro_bin2hex(magic, 3, &(message->magic), 1);
+  debug_print(magic);
+
+  return message->message_len;
+}
+
+/**
+ * @brief Write the frame counters of every receive state to the host UART
+ *
+ * One line per awaited message type that has seen any frames, with the
+ * LINK_STATS counters in order, then one line of ARQ_STATS counters and the
+ * current retransmission timeout, and one of the bytes lost by both UARTs.
+ */
+void board_link_report(void) {
+  for (uint32_t i = 0; i <= NUM_FRAME_TYPES; i++) {
+    LINK_STATS *stats = &link_stats[i];
+    uint32_t *counters = (uint32_t *)stats;
+    uint32_t total = 0;
+
+    for (uint32_t j = 0; j < sizeof(LINK_STATS) / sizeof(uint32_t); j++) {
+      total |= counters[j];
+    }
+    if (total == 0) {
+      continue;
+    }
+
+    uart_write(HOST_UART, (uint8_t *)"\r\nLink ", 7);
+    if (i < NUM_FRAME_TYPES) {
+      uart_write_hex_u32(HOST_UART, frame_types[i].magic);
+    } else {
+      uart_write(HOST_UART, (uint8_t *)"any", 3);
+    }
+    uart_write(HOST_UART, (uint8_t *)": accepted ", 11);
+    uart_write_hex_u32(HOST_UART, stats->accepted);
+    uart_write(HOST_UART, (uint8_t *)" bad_frame ", 11);
+    uart_write_hex_u32(HOST_UART, stats->bad_frame);
+    uart_write(HOST_UART, (uint8_t *)" bad_length ", 12);
+    uart_write_hex_u32(HOST_UART, stats->bad_length);
+    uart_write(HOST_UART, (uint8_t *)" unexpected ", 12);
+    uart_write_hex_u32(HOST_UART, stats->unexpected);
+    uart_write(HOST_UART, (uint8_t *)" bad_mac ", 9);
+    uart_write_hex_u32(HOST_UART, stats->bad_mac);
+    uart_write(HOST_UART, (uint8_t *)" duplicate ", 11);
+    uart_write_hex_u32(HOST_UART, stats->duplicate);
+    uart_write(HOST_UART, (uint8_t *)" corrected ", 11);
+    uart_write_hex_u32(HOST_UART, stats->corrected);
+  }
+
+  uart_write(HOST_UART, (uint8_t *)"\r\nLink arq: sent ", 17);
+  uart_write_hex_u32(HOST_UART, arq_stats.sent);
+  uart_write(HOST_UART, (uint8_t *)" retransmits ", 13);
+  uart_write_hex_u32(HOST_UART, arq_stats.retransmits);
+  uart_write(HOST_UART, (uint8_t *)" gave_up ", 9);
+  uart_write_hex_u32(HOST_UART, arq_stats.gave_up);
+  uart_write(HOST_UART, (uint8_t *)" rto_ms ", 8);
+  uart_write_hex_u32(HOST_UART, rto_ms);
+
+  uart_write(HOST_UART, (uint8_t *)"\r\nLink uart: host_overruns ", 27);
+  uart_write_hex_u32(HOST_UART, uart_rx_overruns(HOST_UART));
+  uart_write(HOST_UART, (uint8_t *)" board_overruns ", 16);
+  uart_write_hex_u32(HOST_UART, uart_rx_overruns(BOARD_UART));
+  uart_write(HOST_UART, (uint8_t *)"\r\n", 2);
+}
@@ -54,7 +54,7 @@ void crypto_test(void) {
 
   uint8_t message_hash[hydro_hash_BYTES];
   hydro_hash_hash(message_hash, sizeof(message_hash), message, strlen(message),
-                  "Test", NULL);
+                  context, NULL);
 
   debug_print("\r\nMessage hash: ");
 
@@ -0,0 +1,293 @@
+/**
+ * @file fec.c
+ * @brief Reed-Solomon forward error correction for board link frames
+ * @date 2023
+ *
+ * A shortened RS(255, 247) code over GF(2^8) with the primitive polynomial
+ * x^8 + x^4 + x^3 + x^2 + 1, and generator roots alpha^0 to alpha^7.
+ * Codewords are stored highest degree first, data then parity.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "fec.h"
+
+#define GF_POLY 0x11D
+
+// Powers of alpha, twice over so that products need no reduction, and their
+// logarithms
+static uint8_t gf_exp[2 * 255];
+static uint8_t gf_log[256];
+
+// Generator polynomial, highest degree first, with gen[0] = 1
+static uint8_t gen[FEC_BLOCK_PARITY + 1];
+
+/**
+ * @brief Multiply in GF(2^8)
+ */
+static uint8_t gf_mul(uint8_t a, uint8_t b) {
+  if (a == 0 || b == 0) {
+    return 0;
+  }
+  return gf_exp[gf_log[a] + gf_log[b]];
+}
+
+/**
+ * @brief Divide in GF(2^8), b must not be zero
+ */
+static uint8_t gf_div(uint8_t a, uint8_t b) {
+  if (a == 0) {
+    return 0;
+  }
+  return gf_exp[gf_log[a] + 255 - gf_log[b]];
+}
+
+/**
+ * @brief Evaluate a polynomial stored lowest degree first
+ *
+ * @param poly the coefficients
+ * @param degree the degree
+ * @param x the point to evaluate at
+ * @return uint8_t the value
+ */
+static uint8_t poly_eval(const uint8_t *poly, uint32_t degree, uint8_t x) {
+  uint8_t y = poly[degree];
+
+  for (uint32_t i = degree; i > 0; i--) {
+    y = gf_mul(y, x) ^ poly[i - 1];
+  }
+  return y;
+}
+
+/**
+ * @brief Build the GF(2^8) tables and the generator polynomial
+ *
+ * Must be called before fec_encode or fec_decode.
+ */
+void fec_init(void) {
+  uint32_t x = 1;
+
+  for (uint32_t i = 0; i < 255; i++) {
+    gf_exp[i] = x;
+    gf_exp[i + 255] = x;
+    gf_log[x] = i;
+    x <<= 1;
+    if (x & 0x100) {
+      x ^= GF_POLY;
+    }
+  }
+
+  // Multiply out (x - alpha^0)...(x - alpha^(FEC_BLOCK_PARITY - 1))
+  memset(gen, 0, sizeof(gen));
+  gen[0] = 1;
+  for (uint32_t i = 0; i < FEC_BLOCK_PARITY; i++) {
+    for (uint32_t j = i + 1; j > 0; j--) {
+      gen[j] ^= gf_mul(gen[j - 1], gf_exp[i]);
+    }
+  }
+}
+
+/**
+ * @brief Compute the parity of one block
+ *
+ * The remainder of the data times x^FEC_BLOCK_PARITY divided by the generator
+ * polynomial, worked out one data byte at a time.
+ *
+ * @param parity where to store the FEC_BLOCK_PARITY parity bytes
+ * @param data the block's data
+ * @param length the block's data length
+ */
+static void encode_block(uint8_t *parity, const uint8_t *data,
+                         uint32_t length) {
+  memset(parity, 0, FEC_BLOCK_PARITY);
+
+  for (uint32_t i = 0; i < length; i++) {
+    uint8_t feedback = data[i] ^ parity[0];
+
+    memmove(parity, &parity[1], FEC_BLOCK_PARITY - 1);
+    parity[FEC_BLOCK_PARITY - 1] = 0;
+
+    if (feedback) {
+      for (uint32_t j = 0; j < FEC_BLOCK_PARITY; j++) {
+        parity[j] ^= gf_mul(gen[j + 1], feedback);
+      }
+    }
+  }
+}
+
+/**
+ * @brief Add parity to every block of a frame
+ *
+ * @param coded where to store the coded frame, FEC_CODED_LENGTH(length) bytes
+ * @param frame the frame
+ * @param length the frame length
+ * @return uint32_t the coded length
+ */
+uint32_t fec_encode(uint8_t *coded, const uint8_t *frame, uint32_t length) {
+  uint32_t coded_len = 0;
+
+  for (uint32_t start = 0; start < length; start += FEC_BLOCK_DATA) {
+    uint32_t block_len = length - start;
+    if (block_len > FEC_BLOCK_DATA) {
+      block_len = FEC_BLOCK_DATA;
+    }
+
+    memcpy(&coded[coded_len], &frame[start], block_len);
+    encode_block(&coded[coded_len + block_len], &frame[start], block_len);
+    coded_len += block_len + FEC_BLOCK_PARITY;
+  }
+
+  return coded_len;
+}
+
+/**
+ * @brief Correct one block in place
+ *
+ * Finds the error locator with Berlekamp-Massey, the bad bytes as its roots
+ * (Chien search) and their values with Forney's formula.
+ *
+ * @param block the block, data then parity
+ * @param length the block length, parity included
+ * @return int32_t the number of bytes corrected, or -1 if there are more than
+ * FEC_MAX_ERRORS
+ */
+static int32_t decode_block(uint8_t *block, uint32_t length) {
+  uint8_t syndromes[FEC_BLOCK_PARITY];
+  bool clean = true;
+
+  for (uint32_t i = 0; i < FEC_BLOCK_PARITY; i++) {
+    uint8_t s = 0;
+    for (uint32_t j = 0; j < length; j++) {
+      s = gf_mul(s, gf_exp[i]) ^ block[j];
+    }
+    syndromes[i] = s;
+    clean &= (s == 0);
+  }
+
+  if (clean) {
+    return 0;
+  }
+
+  // Error locator, lowest degree first
+  uint8_t locator[FEC_BLOCK_PARITY + 1] = {1};
+  uint8_t previous[FEC_BLOCK_PARITY + 1] = {1};
+  uint32_t errors = 0;
+  uint32_t shift = 1;
+  uint8_t previous_discrepancy = 1;
+
+  for (uint32_t n = 0; n < FEC_BLOCK_PARITY; n++) {
+    uint8_t discrepancy = syndromes[n];
+    for (uint32_t i = 1; i <= errors; i++) {
+      discrepancy ^= gf_mul(locator[i], syndromes[n - i]);
+    }
+
+    if (discrepancy == 0) {
+      shift++;
+      continue;
+    }
+
+    uint8_t scale = gf_div(discrepancy, previous_discrepancy);
+    uint8_t saved[FEC_BLOCK_PARITY + 1];
+    memcpy(saved, locator, sizeof(saved));
+
+    for (uint32_t i = 0; i + shift <= FEC_BLOCK_PARITY; i++) {
+      locator[i + shift] ^= gf_mul(scale, previous[i]);
+    }
+
+    if (2 * errors <= n) {
+      errors = n + 1 - errors;
+      memcpy(previous, saved, sizeof(previous));
+      previous_discrepancy = discrepancy;
+      shift = 1;
+    } else {
+      shift++;
+    }
+  }
+
+  if (errors > FEC_MAX_ERRORS) {
+    return -1;
+  }
+
+  // Error evaluator, the syndromes times the locator mod x^FEC_BLOCK_PARITY
+  uint8_t evaluator[FEC_BLOCK_PARITY] = {0};
+  for (uint32_t i = 0; i < FEC_BLOCK_PARITY; i++) {
+    for (uint32_t j = 0; j <= i && j <= errors; j++) {
+      evaluator[i] ^= gf_mul(syndromes[i - j], locator[j]);
+    }
+  }
+
+  // Formal derivative of the locator, only odd powers survive in GF(2^8)
+  uint8_t derivative[FEC_BLOCK_PARITY] = {0};
+  for (uint32_t i = 1; i <= errors; i += 2) {
+    derivative[i - 1] = locator[i];
+  }
+
+  uint32_t found = 0;
+  for (uint32_t j = 0; j < length; j++) {
+    uint32_t power = length - 1 - j;
+    uint8_t inverse = gf_exp[(255 - power) % 255];
+
+    if (poly_eval(locator, errors, inverse) != 0) {
+      continue;
+    }
+
+    uint8_t denominator = poly_eval(derivative, FEC_BLOCK_PARITY - 1, inverse);
+    if (denominator == 0) {
+      return -1;
+    }
+
+    block[j] ^= gf_mul(gf_exp[power],
+                       gf_div(poly_eval(evaluator, FEC_BLOCK_PARITY - 1,
+                                        inverse),
+                              denominator));
+    found++;
+  }
+
+  // Roots outside the block mean the errors are past correcting
+  return found == errors ? (int32_t)found : -1;
+}
+
+/**
+ * @brief Correct a coded frame and strip its parity
+ *
+ * @param frame where to store the frame, may be the same buffer as coded
+ * @param coded the coded frame, corrected in place
+ * @param coded_len the coded length
+ * @param corrected set to the number of bytes corrected
+ * @return int32_t the frame length, or -1 if a block has too many bad bytes
+ * or the coded length is impossible
+ */
+int32_t fec_decode(uint8_t *frame, uint8_t *coded, uint32_t coded_len,
+                   uint32_t *corrected) {
+  const uint32_t coded_block = FEC_BLOCK_DATA + FEC_BLOCK_PARITY;
+  uint32_t length = 0;
+
+  *corrected = 0;
+
+  // Only the last block can be short, and it has at least one data byte
+  if (coded_len % coded_block != 0 &&
+      coded_len % coded_block <= FEC_BLOCK_PARITY) {
+    return -1;
+  }
+
+  for (uint32_t start = 0; start < coded_len; start += coded_block) {
+    uint32_t block_len = coded_len - start;
+    if (block_len > coded_block) {
+      block_len = coded_block;
+    }
+
+    int32_t fixed = decode_block(&coded[start], block_len);
+    if (fixed < 0) {
+      return -1;
+    }
+    *corrected += fixed;
+
+    // Blocks only move down, so decoding in place is safe
+    memmove(&frame[length], &coded[start], block_len - FEC_BLOCK_PARITY);
+    length += block_len - FEC_BLOCK_PARITY;
+  }
+
+  return length;
+}
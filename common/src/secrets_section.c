@@ -0,0 +1,38 @@
+/**
+ * @file secrets_section.c
+ * @brief Per-device secrets section
+ * @date 2023
+ *
+ * This is the only file that includes the generated secrets.h, so building
+ * an image for a new device only recompiles this file. Template images are
+ * built once and then provisioned by scripts/stamp_secrets.py instead.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "driverlib/sw_crc.h"
+
+#include "secrets_section.h"
+
+#include "secrets.h"
+
+/**
+ * @brief Check that the secrets section has been provisioned
+ *
+ * @return true if the magic, version and checksum are correct
+ * @return false for an unstamped template or a corrupted image
+ */
+bool image_secrets_valid(void) {
+  if ((image_secrets.magic != SECRETS_MAGIC) ||
+      (image_secrets.version != SECRETS_VERSION)) {
+    return false;
+  }
+
+  uint32_t checksum = Crc32(0xFFFFFFFF, (const uint8_t *)&image_secrets,
+                            offsetof(IMAGE_SECRETS, checksum)) ^
+                      0xFFFFFFFF;
+
+  return checksum == image_secrets.checksum;
+}
@@ -0,0 +1,52 @@
+/**
+ * @file stack.c
+ * @brief Stack usage measurement
+ * @date 2023
+ */
+
+#include <stdint.h>
+
+#include "stack.h"
+#include "uart.h"
+
+// Provided by firmware.ld
+extern uint32_t _stack_bottom;
+extern uint32_t _stack_top;
+
+/**
+ * @brief Get the total size of the application stack
+ *
+ * @return uint32_t size of the stack reserved by the linker script in bytes
+ */
+uint32_t stack_size(void) {
+  return (uint32_t)((uint8_t *)&_stack_top - (uint8_t *)&_stack_bottom);
+}
+
+/**
+ * @brief Get the maximum stack depth reached since reset
+ *
+ * The stack grows down from _stack_top, so the first word above _stack_bottom
+ * that has been overwritten is the deepest point the stack has reached.
+ *
+ * @return uint32_t number of stack bytes that have been used
+ */
+uint32_t stack_high_water_mark(void) {
+  volatile uint32_t *word = &_stack_bottom;
+
+  while (word < &_stack_top && *word == STACK_PAINT_PATTERN) {
+    word++;
+  }
+
+  return (uint32_t)((uint8_t *)&_stack_top - (uint8_t *)word);
+}
+
+/**
+ * @brief Write the stack high-water mark and stack size to the host UART
+ */
+void stack_report(void) {
+  uart_write(HOST_UART, (uint8_t *)"\r\nStack high-water mark: ", 25);
+  uart_write_hex_u32(HOST_UART, stack_high_water_mark());
+  uart_write(HOST_UART, (uint8_t *)" / ", 3);
+  uart_write_hex_u32(HOST_UART, stack_size());
+  uart_write(HOST_UART, (uint8_t *)" bytes\r\n", 8);
+}
@@ -0,0 +1,321 @@
+/**
+ * @file uart.c
+ * @author Kyle Scaplen
+ * @brief Firmware UART interface implementation.
+ * @date 2023
+ *
+ * This source file is part of an example system for MITRE's 2023 Embedded
+ * System CTF (eCTF). This code is being provided only for educational purposes
+ * for the 2023 MITRE eCTF competition, and may not meet MITRE standards for
+ * quality. Use this code at your own risk!
+ *
+ * @copyright Copyright (c) 2023 The MITRE Corporation
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "driverlib/fpu.h"
+#include "driverlib/gpio.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/pin_map.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/uart.h"
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+#include "inc/hw_uart.h"
+
+#include "hydrogen.h"
+
+#include "uart.h"
+
+// Bytes written to the host UART since boot
+static uint32_t host_written;
+
+#ifdef TIVA_C
+// Code that must keep running while the flash is erased or programmed, which
+// stalls every instruction fetch from flash. The linker script copies it to
+// SRAM with .data.
+#define RAMFUNC __attribute__((section(".ramfunc"), noinline))
+
+/**
+ * @brief Bytes received on a UART by its interrupt handler, not yet read
+ *
+ * The handler only writes head and the readers only write tail, so the buffer
+ * holds UART_RX_BUFFER_SIZE - 1 bytes.
+ */
+typedef struct {
+  volatile uint16_t head;
+  volatile uint16_t tail;
+  volatile uint32_t overruns;
+  uint8_t data[UART_RX_BUFFER_SIZE];
+} UART_RX_BUFFER;
+
+static UART_RX_BUFFER host_rx;
+static UART_RX_BUFFER board_rx;
+
+#define UART_RX_NEXT(index) (((index) + 1) & (UART_RX_BUFFER_SIZE - 1))
+
+/**
+ * @brief Get the receive buffer of a UART
+ *
+ * @param uart is the base address of the UART port.
+ * @return the buffer of UART 0 or UART 1
+ */
+static UART_RX_BUFFER *uart_rx_buffer(uint32_t uart) {
+  return (uart == HOST_UART) ? &host_rx : &board_rx;
+}
+
+/**
+ * @brief Move every byte in a UART's receive FIFO into its buffer
+ *
+ * Inlined into the interrupt handlers in SRAM, and uses only register
+ * accesses, so that no part of it is fetched from flash.
+ *
+ * @param uart is the base address of the UART port.
+ * @param rx is its receive buffer.
+ */
+static inline __attribute__((always_inline)) void
+uart_rx_drain(uint32_t uart, UART_RX_BUFFER *rx) {
+  uint32_t status = HWREG(uart + UART_O_MIS);
+  HWREG(uart + UART_O_ICR) = status;
+
+  // The receive FIFO filled up before the handler could run
+  if (status & UART_INT_OE) {
+    rx->overruns++;
+  }
+
+  while (!(HWREG(uart + UART_O_FR) & UART_FR_RXFE)) {
+    uint8_t byte = (uint8_t)HWREG(uart + UART_O_DR);
+    uint16_t head = rx->head;
+
+    if (UART_RX_NEXT(head) == rx->tail) {
+      rx->overruns++;
+    } else {
+      rx->data[head] = byte;
+      rx->head = UART_RX_NEXT(head);
+    }
+  }
+}
+
+/**
+ * @brief UART 0 receive interrupt handler
+ */
+RAMFUNC static void uart_host_isr(void) { uart_rx_drain(HOST_UART, &host_rx); }
+
+/**
+ * @brief UART 1 receive interrupt handler
+ */
+RAMFUNC static void uart_board_isr(void) {
+  uart_rx_drain(UART1_BASE, &board_rx);
+}
+#endif
+
+/**
+ * @brief Receive a UART's bytes into a buffer from its interrupt handler
+ *
+ * Interrupts are raised at half a FIFO or after the line has been idle for
+ * a while. The handler and vector table are in SRAM, so bytes keep arriving
+ * while the flash is erased or programmed. Off the board, the UART is read
+ * directly.
+ *
+ * @param uart is the base address of the UART port, UART 0 or UART 1.
+ */
+void uart_enable_rx_interrupt(uint32_t uart) {
+#ifdef TIVA_C
+  UART_RX_BUFFER *rx = uart_rx_buffer(uart);
+
+  rx->head = 0;
+  rx->tail = 0;
+  rx->overruns = 0;
+
+  UARTFIFOLevelSet(uart, UART_FIFO_TX4_8, UART_FIFO_RX4_8);
+  UARTIntRegister(uart, (uart == HOST_UART) ? uart_host_isr : uart_board_isr);
+  UARTIntEnable(uart, UART_INT_RX | UART_INT_RT | UART_INT_OE);
+  IntMasterEnable();
+#endif
+}
+
+/**
+ * @brief Count the received bytes lost on a UART
+ *
+ * @param uart is the base address of the UART port.
+ * @return the bytes dropped because its FIFO or buffer was full, 0 off the
+ * board.
+ */
+uint32_t uart_rx_overruns(uint32_t uart) {
+#ifdef TIVA_C
+  return uart_rx_buffer(uart)->overruns;
+#else
+  return 0;
+#endif
+}
+
+/**
+ * @brief Count the bytes written to the host UART.
+ *
+ * @return the bytes written to the host UART since boot, wrapping at 2^32.
+ */
+uint32_t uart_host_written(void) { return host_written; }
+
+/**
+ * @brief Initialize the UART interfaces.
+ *
+ * UART 0 is used to communicate with the host computer.
+ */
+void uart_init(void) {
+  // Configure the UART peripherals used in this example
+  // RCGC   Run Mode Clock Gating
+  SysCtlPeripheralEnable(SYSCTL_PERIPH_UART0); // UART 0 for host interface
+  SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOA); // UART 0 is on GPIO Port A
+  // HBCTL  High-performance Bus Control
+  // PCTL   Port Control
+  GPIOPinConfigure(GPIO_PA0_U0RX);
+  GPIOPinConfigure(GPIO_PA1_U0TX);
+  // DIR    Direction
+  // AFSEL  Alternate Function Select
+  // DR2R   2-mA Drive Select
+  // DR4R   4-mA Drive Select
+  // DR8R   8-mA Drive Select
+  // SLR    Slew Rate Control Select
+  // ODR    Open Drain Select
+  // PUR    Pull-Up Select
+  // PDR    Pull-Down Select
+  // DEN    Digital Enable
+  // AMSEL  Analog Mode Select
+  GPIOPinTypeUART(GPIO_PORTA_BASE, GPIO_PIN_0 | GPIO_PIN_1);
+
+  // Configure the UART for 115,200, 8-N-1 operation.
+  UARTConfigSetExpClk(
+      UART0_BASE, SysCtlClockGet(), 115200,
+      (UART_CONFIG_WLEN_8 | UART_CONFIG_STOP_ONE | UART_CONFIG_PAR_NONE));
+
+  uart_enable_rx_interrupt(HOST_UART);
+}
+
+/**
+ * @brief Check if there are characters available on a UART interface.
+ *
+ * @param uart is the base address of the UART port.
+ * @return true if there is data available.
+ * @return false if there is no data available.
+ */
+bool uart_avail(uint32_t uart) {
+#ifdef TIVA_C
+  UART_RX_BUFFER *rx = uart_rx_buffer(uart);
+  return rx->head != rx->tail;
+#else
+  return UARTCharsAvail(uart);
+#endif
+}
+
+/**
+ * @brief Read a byte from a UART interface.
+ *
+ * @param uart is the base address of the UART port to read from.
+ * @return the character read from the interface.
+ */
+int32_t uart_readb(uint32_t uart) {
+#ifdef TIVA_C
+  UART_RX_BUFFER *rx = uart_rx_buffer(uart);
+  uint16_t tail = rx->tail;
+
+  while (rx->head == tail)
+    ;
+
+  uint8_t byte = rx->data[tail];
+  rx->tail = UART_RX_NEXT(tail);
+  return byte;
+#else
+  return UARTCharGet(uart);
+#endif
+}
+
+/**
+ * @brief Read a sequence of bytes from a UART interface.
+ *
+ * @param uart is the base address of the UART port to read from.
+ * @param buf is a pointer to the destination for the received data.
+ * @param n is the number of bytes to read.
+ * @return the number of bytes read from the UART interface.
+ */
+uint32_t uart_read(uint32_t uart, uint8_t *buf, uint32_t n) {
+  uint32_t read;
+
+  for (read = 0; read < n; read++) {
+    buf[read] = (uint8_t)uart_readb(uart);
+  }
+  return read;
+}
+
+/**
+ * @brief Read a line (terminated with '\n') from a UART interface.
+ *
+ * @param uart is the base address of the UART port to read from.
+ * @param buf is a pointer to the destination for the received data.
+ * @return the number of bytes read from the UART interface.
+ */
+uint32_t uart_readline(uint32_t uart, uint8_t *buf) {
+  uint32_t read = 0;
+  uint8_t c;
+
+  do {
+    c = (uint8_t)uart_readb(uart);
+
+    if ((c != '\r') && (c != '\n') && (c != 0xD)) {
+      buf[read] = c;
+      read++;
+    }
+  } while ((c != '\n') && (c != 0xD));
+
+  buf[read] = '\0';
+
+  return read;
+}
+
+/**
+ * @brief Write a byte to a UART interface.
+ *
+ * @param uart is the base address of the UART port to write to.
+ * @param data is the byte value to write.
+ */
+void uart_writeb(uint32_t uart, uint8_t data) {
+  if (uart == HOST_UART) {
+    host_written++;
+  }
+  UARTCharPut(uart, data);
+}
+
+/**
+ * @brief Write a sequence of bytes to a UART interface.
+ *
+ * @param uart is the base address of the UART port to write to.
+ * @param buf is a pointer to the data to send.
+ * @param len is the number of bytes to send.
+ * @return the number of bytes written.
+ */
+uint32_t uart_write(uint32_t uart, uint8_t *buf, uint32_t len) {
+  uint32_t i;
+
+  for (i = 0; i < len; i++) {
+    uart_writeb(uart, buf[i]);
+  }
+
+  return i;
+}
+
+/**
+ * @brief Write a 32-bit value to a UART interface as "0x" and 8 hex digits.
+ *
+ * @param uart is the base address of the UART port to write to.
+ * @param value is the value to write.
+ */
+void uart_write_hex_u32(uint32_t uart, uint32_t value) {
+  uint8_t bytes[4] = {value >> 24, value >> 16, value >> 8, value};
+  char hex[9];
+
+  hydro_bin2hex(hex, sizeof(hex), bytes, sizeof(bytes));
+  uart_write(uart, (uint8_t *)"0x", 2);
+  uart_write(uart, (uint8_t *)hex, 8);
+}
@@ -3,16 +3,20 @@
 
 #include "./lib/libhydrogen/hydrogen.h"
 
-// Generate a shared secret key for car and paired fob
+// Generate the deployment master key. Each car's board link key is derived
+// from it with hydro_kdf keyed by the car ID (see derive_key.c in car and
+// fob), so no per-car key needs to be stored.
+//
+// Master key saved as plain hex string.
 int main(void) {
-  char context[] = "genkey";
-  uint8_t shared_key[hydro_secretbox_KEYBYTES];
+  uint8_t master_key[hydro_kdf_KEYBYTES];
 
   hydro_init();
 
-  hydro_secretbox_keygen(shared_key);
+  hydro_kdf_keygen(master_key);
 
-  for (int i = 0; i < 32; i++) {
-    printf("0x%x,", shared_key[i]);
-  }
+  char master_key_str[hydro_kdf_KEYBYTES * 2 + 1];
+  hydro_bin2hex(master_key_str, sizeof(master_key_str), master_key,
+                sizeof(master_key));
+  printf("%s", master_key_str);
 }
@@ -0,0 +1,45 @@
+#ifndef hydrogen_H
+#define hydrogen_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#define hydro_secretbox_HEADERBYTES (20 + 16)
+#define hydro_secretbox_KEYBYTES 32
+#define hydro_secretbox_CONTEXTBYTES 8
+#define hydro_sign_BYTES 64
+#define hydro_sign_PUBLICKEYBYTES 32
+#define hydro_sign_SECRETKEYBYTES 64
+#define hydro_hash_BYTES 32
+#define hydro_hash_BYTES_MAX 65535
+#define hydro_hash_KEYBYTES 32
+#define hydro_hash_CONTEXTBYTES 8
+#define hydro_kdf_KEYBYTES 32
+#define hydro_kdf_CONTEXTBYTES 8
+#define hydro_random_SEEDBYTES 32
+#define hydro_sign_CONTEXTBYTES 8
+typedef struct { uint8_t pk[32]; uint8_t sk[64]; } hydro_sign_keypair;
+typedef struct { uint8_t state[12 * 4]; uint8_t buf_off; uint8_t align[3]; } hydro_hash_state;
+typedef struct { hydro_hash_state hash_st; } hydro_sign_state;
+int hydro_init(void);
+uint32_t hydro_random_u32(void);
+void hydro_random_buf(void *out, size_t out_len);
+void hydro_random_buf_deterministic(void *out, size_t out_len, const uint8_t seed[hydro_random_SEEDBYTES]);
+void hydro_random_ratchet(void);
+void hydro_random_reseed(void);
+int hydro_hash_init(hydro_hash_state *state, const char ctx[hydro_hash_CONTEXTBYTES], const uint8_t key[hydro_hash_KEYBYTES]);
+int hydro_hash_update(hydro_hash_state *state, const void *in_, size_t in_len);
+int hydro_hash_final(hydro_hash_state *state, uint8_t *out, size_t out_len);
+int hydro_hash_hash(uint8_t *out, size_t out_len, const void *in_, size_t in_len, const char ctx[hydro_hash_CONTEXTBYTES], const uint8_t key[hydro_hash_KEYBYTES]);
+void hydro_secretbox_keygen(uint8_t key[hydro_secretbox_KEYBYTES]);
+int hydro_secretbox_encrypt(uint8_t *c, const void *m_, size_t mlen, uint64_t msg_id, const char ctx[hydro_secretbox_CONTEXTBYTES], const uint8_t key[hydro_secretbox_KEYBYTES]);
+int hydro_secretbox_decrypt(void *m_, const uint8_t *c, size_t clen, uint64_t msg_id, const char ctx[hydro_secretbox_CONTEXTBYTES], const uint8_t key[hydro_secretbox_KEYBYTES]);
+int hydro_kdf_derive_from_key(uint8_t *subkey, size_t subkey_len, uint64_t subkey_id, const char ctx[hydro_kdf_CONTEXTBYTES], const uint8_t key[hydro_kdf_KEYBYTES]);
+void hydro_sign_keygen(hydro_sign_keypair *kp);
+int hydro_sign_create(uint8_t csig[hydro_sign_BYTES], const void *m_, size_t mlen, const char ctx[hydro_sign_CONTEXTBYTES], const uint8_t sk[hydro_sign_SECRETKEYBYTES]);
+int hydro_sign_verify(const uint8_t csig[hydro_sign_BYTES], const void *m_, size_t mlen, const char ctx[hydro_sign_CONTEXTBYTES], const uint8_t pk[hydro_sign_PUBLICKEYBYTES]);
+void hydro_memzero(void *pnt, size_t len);
+bool hydro_equal(const void *b1_, const void *b2_, size_t len);
+char *hydro_bin2hex(char *hex, size_t hex_maxlen, const uint8_t *bin, size_t bin_len);
+int hydro_hex2bin(uint8_t *bin, size_t bin_maxlen, const char *hex, size_t hex_len, const char *ignore, const char **hex_end_p);
+void hydro_kdf_keygen(uint8_t key[hydro_kdf_KEYBYTES]);
+#endif
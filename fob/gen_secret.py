@@ -13,53 +13,97 @@
 # @copyright Copyright (c) 2023 The MITRE Corporation
 
 import argparse
+import struct
+import subprocess
+import zlib
 from pathlib import Path
 
+# Layout of IMAGE_SECRETS in secrets_section.h, excluding the checksum
+SECRETS_MAGIC = 0x53435254
+SECRETS_VERSION = 1
+SECRETS_FORMAT = "<IIII8s32s32s"
+
+
+# @brief Parse a "0xXX,0xXX," byte list as written by the deployment tools
+def parse_c_bytes(text):
+    return bytes(int(b, 16) for b in text.strip().split(",") if b.strip())
+
+
+# @brief Format bytes as a C initializer list
+def c_bytes(data):
+    return "{" + ", ".join(f"0x{b:02x}" for b in data) + "}"
+
+
+# @brief Write the IMAGE_SECRETS definition for secrets_section.c
+#
+# A template is written with a zero checksum so it refuses to boot until it
+# has been stamped by scripts/stamp_secrets.py.
+def write_secrets(header_file, guard, car_id, paired, pair_pin, message_key,
+                  signing_public_key, template=False):
+    pin = pair_pin.encode().ljust(8, b"\0")
+    packed = struct.pack(SECRETS_FORMAT, SECRETS_MAGIC, SECRETS_VERSION, car_id,
+                         paired, pin, message_key, signing_public_key)
+    checksum = 0 if template else zlib.crc32(packed)
+
+    with open(header_file, "w") as f:
+        f.write(f"#ifndef {guard}\n")
+        f.write(f"#define {guard}\n\n")
+        f.write('#include "secrets_section.h"\n\n')
+        f.write("const volatile IMAGE_SECRETS image_secrets\n")
+        f.write('    __attribute__((section(".secrets"), used)) = {\n')
+        f.write("        .magic = SECRETS_MAGIC,\n")
+        f.write("        .version = SECRETS_VERSION,\n")
+        f.write(f"        .car_id = {car_id},\n")
+        f.write(f"        .paired = {paired},\n")
+        f.write(f"        .pair_pin = {c_bytes(pin)},\n")
+        f.write(f"        .message_key = {c_bytes(message_key)},\n")
+        f.write(f"        .signing_public_key = {c_bytes(signing_public_key)},\n")
+        f.write(f"        .checksum = 0x{checksum:08x},\n")
+        f.write("};\n\n")
+        f.write("#endif\n")
+
 
 def main():
     parser = argparse.ArgumentParser()
     parser.add_argument("--car-id", type=int)
     parser.add_argument("--pair-pin", type=str)
-    parser.add_argument("--secret-key-file", type=Path)
+    parser.add_argument("--master-key-file", type=Path)
+    parser.add_argument("--derive-key-tool", type=Path)
     parser.add_argument("--signing-public-key-file", type=Path)
     parser.add_argument("--header-file", type=Path)
     parser.add_argument("--paired", action="store_true")
+    parser.add_argument("--template", action="store_true")
     args = parser.parse_args()
 
+    # Templates carry no secrets, they are stamped after linking
+    if args.template:
+        write_secrets(args.header_file, "__FOB_SECRETS__", 0, 0, "", bytes(32),
+                      bytes(32), template=True)
+        return
+
     if args.signing_public_key_file.exists():
         with open(args.signing_public_key_file, "r") as f:
-            signing_public_key = f.readline()
+            signing_public_key = parse_c_bytes(f.readline())
     else:
         raise RuntimeError
 
     if args.paired:
-        # Open the secret file, get the car's secret
-        with open(args.secret_key_file, "r") as f:
-            secret_key = f.readline()
+        # Derive the car's link key from the deployment master key
+        secret_key = subprocess.run(
+            [args.derive_key_tool, args.master_key_file, str(args.car_id)],
+            check=True,
+            capture_output=True,
+            text=True,
+        ).stdout
 
         # Write to header file
-        with open(args.header_file, "w") as f:
-            f.write("#ifndef __FOB_SECRETS__\n")
-            f.write("#define __FOB_SECRETS__\n\n")
-            f.write("#define PAIRED 1\n")
-            f.write(f'#define PAIR_PIN "{args.pair_pin}"\n')
-            f.write(f'#define CAR_ID {args.car_id}\n\n')
-            f.write(f'const uint8_t MESSAGE_KEY[hydro_secretbox_KEYBYTES] = {{{secret_key}}};\n\n')
-            f.write(f'const uint8_t SIGNING_PUBLIC_KEY[hydro_sign_PUBLICKEYBYTES] = {{{signing_public_key}}};\n\n')
-            f.write("#endif\n")
+        write_secrets(args.header_file, "__FOB_SECRETS__", args.car_id, 1,
+                      args.pair_pin, parse_c_bytes(secret_key),
+                      signing_public_key)
     else:
         # Write to header file
-        with open(args.header_file, "w") as f:
-            f.write("#ifndef __FOB_SECRETS__\n")
-            f.write("#define __FOB_SECRETS__\n\n")
-            f.write("#include <stdint.h>\n")
-            f.write("#include \"hydrogen.h\"\n")
-            f.write("#define PAIRED 0\n")
-            f.write('#define PAIR_PIN "000000"\n')
-            f.write('#define CAR_ID 0\n\n')
-            f.write('const uint8_t MESSAGE_KEY[hydro_secretbox_KEYBYTES] = {0x00};\n\n')
-            f.write(f'const uint8_t SIGNING_PUBLIC_KEY[hydro_sign_PUBLICKEYBYTES] = {{{signing_public_key}}};\n\n')
-            f.write("#endif\n")
+        write_secrets(args.header_file, "__FOB_SECRETS__", 0, 0, "000000",
+                      bytes(32), signing_public_key)
 
 
 if __name__ == "__main__":
@@ -1,6 +0,0 @@
-#ifndef ENC_H
-#define ENC_H
-
-void crypto_test(void);
-
-#endif // ENC_H
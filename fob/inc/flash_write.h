@@ -0,0 +1,60 @@
+/**
+ * @file flash_write.h
+ * @brief Flash page rewrites split into short steps
+ * @date 2023
+ *
+ * Erasing or programming the flash stalls every instruction fetch from it.
+ * A page is rewritten with one erase step and then one step per
+ * FLASH_WRITE_CHUNK bytes, each of them run by the TivaWare ROM, so that the
+ * main loop can run between steps and the UART interrupt handlers in SRAM
+ * can run during them.
+ */
+
+#ifndef FLASH_WRITE_H
+#define FLASH_WRITE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Bytes programmed per step, a multiple of 4
+#define FLASH_WRITE_CHUNK 64
+
+/**
+ * @brief A page rewrite in progress
+ */
+typedef struct {
+  const uint8_t *data; // kept unchanged until the rewrite is done
+  uint32_t address;    // start of the flash page
+  uint32_t length;     // a multiple of 4, at most one page
+  uint32_t written;    // bytes programmed so far
+  bool erased;
+  bool busy;
+} FLASH_WRITE;
+
+/**
+ * @brief Start rewriting a flash page, replacing any rewrite in progress
+ *
+ * @param write the rewrite
+ * @param address start of the page
+ * @param data word-aligned data to write at its start
+ * @param length length of data, a multiple of 4
+ */
+void flash_write_start(FLASH_WRITE *write, uint32_t address, const void *data,
+                       uint32_t length);
+
+/**
+ * @brief Run the next step of a rewrite
+ *
+ * @param write the rewrite
+ * @return bool true if steps remain
+ */
+bool flash_write_step(FLASH_WRITE *write);
+
+/**
+ * @brief Run every remaining step of a rewrite
+ *
+ * @param write the rewrite
+ */
+void flash_write_finish(FLASH_WRITE *write);
+
+#endif // FLASH_WRITE_H
@@ -1,6 +0,0 @@
-#ifndef HWSEC_H_
-#define HWSEC_H_
-
-void lockdown(void);
-
-#endif // HWSEC_H_
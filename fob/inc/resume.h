@@ -0,0 +1,68 @@
+/**
+ * @file resume.h
+ * @brief Hibernation of the fob between unlocks, and resume on the wake button
+ * @date 2023
+ *
+ * The hibernation module powers the rest of the part down and keeps 16 words
+ * of memory for as long as it has battery power. A press of the button on the
+ * WAKE pin (SW2 on the LaunchPad) powers it back up through a reset, and the
+ * fob resumes by sending a handshake request for the press before anything
+ * else, rather than booting and waiting for SW1.
+ *
+ * Only RESUME_RECORD is kept in hibernation memory. The fob state stays in
+ * flash, and libhydrogen's RNG state is private and reseeded by hydro_init on
+ * every power up, so that no RNG output or START message ciphertext can be
+ * replayed by resuming twice from the same memory.
+ */
+
+#ifndef RESUME_H
+#define RESUME_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Seconds without host input or an SW1 press before the fob hibernates, 0 to
+// only hibernate on the hibernate host command
+#ifndef HIBERNATE_IDLE_S
+#define HIBERNATE_IDLE_S 0
+#endif
+
+/**
+ * @brief What the fob keeps in hibernation memory
+ */
+typedef struct {
+  uint32_t magic;
+  uint32_t cold_ready_ticks; // board link setup to ready, on the last cold boot
+  uint32_t hibernations;
+} RESUME_RECORD;
+
+/**
+ * @brief Find out whether the fob is resuming from hibernation
+ *
+ * @param record filled with the record kept in hibernation, or zeroed
+ * @return bool true if woken by the wake button with a record kept
+ */
+bool resume_check(RESUME_RECORD *record);
+
+/**
+ * @brief Hibernate until the wake button is pressed
+ *
+ * @param record the record to keep in hibernation
+ */
+void resume_hibernate(RESUME_RECORD *record);
+
+/**
+ * @brief Restart the idle time that leads to hibernation
+ */
+void resume_idle_reset(void);
+
+/**
+ * @brief Check whether the fob has been idle for HIBERNATE_IDLE_S
+ *
+ * Called from the main loop, at least every 50 seconds.
+ *
+ * @return bool true once the fob has been idle long enough
+ */
+bool resume_idle_expired(void);
+
+#endif // RESUME_H
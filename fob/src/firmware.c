@@ -20,7 +20,6 @@
 #include "inc/hw_memmap.h"
 
 #include "driverlib/eeprom.h"
-#include "driverlib/flash.h"
 #include "driverlib/gpio.h"
 #include "driverlib/interrupt.h"
 #include "driverlib/pin_map.h"
@@ -29,16 +28,21 @@
 
 #include "hydrogen.h"
 
-#include "secrets.h"
-
 #include "board_link.h"
 #include "debug.h"
 #include "enc.h"
 #include "feature_list.h"
+#include "flash_write.h"
 #include "hwsec.h"
+#include "resume.h"
+#include "secrets_section.h"
+#include "stack.h"
 #include "uart.h"
 
+// Moved into emulated flash by the QEMU build
+#ifndef FOB_STATE_PTR
 #define FOB_STATE_PTR 0x3FC00
+#endif
 #define FLASH_DATA_SIZE                                                        \
   (sizeof(FLASH_DATA) % 4 == 0)                                                \
       ? sizeof(FLASH_DATA)                                                     \
@@ -46,6 +50,21 @@
 #define FLASH_PAIRED 0x00
 #define FLASH_UNPAIRED 0xFF
 
+// Per-package status characters returned by enable-batch, each sent after
+// ENABLE_STATUS_PREFIX, which debug output never contains, so that the host
+// can tell a status from debug text
+#define ENABLE_STATUS_PREFIX 0x06
+#define ENABLE_OK '0'
+#define ENABLE_MALFORMED '1'
+#define ENABLE_WRONG_CAR '2'
+#define ENABLE_FULL '3'
+#define ENABLE_DUPLICATE '4'
+#define ENABLE_BAD_SIGNATURE '5'
+
+// Sent before the "P" that asks the host for the pairing pin, so that the
+// host can tell the request from debug text
+#define PAIR_PROMPT_PREFIX 0x05
+
 /*** Structure definitions ***/
 // Defines a struct for the format of an enable message
 typedef struct {
@@ -54,21 +73,6 @@ typedef struct {
   uint8_t signature[hydro_sign_BYTES];
 } __attribute__((packed)) ENABLE_PACKET;
 
-// Defines a struct for the format of a pairing message
-typedef struct {
-  uint32_t car_id;
-  uint8_t pin[8];
-  uint8_t message_key[hydro_secretbox_KEYBYTES];
-} PAIR_PACKET;
-
-// Defines a struct for the format of start message
-typedef struct {
-  uint32_t car_id;
-  uint8_t num_active;
-  uint8_t features[NUM_FEATURES];
-  uint8_t signatures[NUM_FEATURES][hydro_sign_BYTES];
-} FEATURE_DATA;
-
 // Defines a struct for storing the state in flash
 typedef struct {
   uint8_t paired;
@@ -79,21 +83,50 @@ typedef struct {
 
 /*** Function definitions ***/
 // Core functions - all functionality supported by fob
-void saveFobState(FLASH_DATA *flash_data);
+void saveFobState(FLASH_DATA *flash_data, const char *reply);
+bool commitFobState(bool wait);
 void pairFob(FLASH_DATA *fob_state_ram);
-uint32_t performHandshake(void);
-void unlockCar(FLASH_DATA *fob_state_ram);
+void requestHandshake(void);
+uint32_t performHandshake(bool requested);
+bool unlockCar(FLASH_DATA *fob_state_ram, bool requested);
+bool unlockAndStart(FLASH_DATA *fob_state_ram, bool requested);
+void hibernateFob(void);
 void enableFeature(FLASH_DATA *fob_state_ram);
+void enableFeatureBatch(FLASH_DATA *fob_state_ram);
 void startCar(FLASH_DATA *fob_state_ram);
+void prepareStart(FLASH_DATA *fob_state_ram);
+void boot_report(uint32_t hydro_ticks, uint32_t ready_ticks, bool resumed);
+void unlock_report(uint32_t ticks);
 
-// Helper functions - receive ack message
+// Helper functions - receive ack message and feature packages
 uint8_t receiveAck();
+bool receiveEnablePacket(ENABLE_PACKET *enable_message);
+uint8_t applyEnablePacket(FLASH_DATA *fob_state_ram,
+                          ENABLE_PACKET *enable_message);
 
 // Inter-board message encryption key
-uint8_t *message_key = MESSAGE_KEY;
+uint8_t *message_key = (uint8_t *)image_secrets.message_key;
 
 // Feature package verification key
-uint8_t *feature_verification_key = SIGNING_PUBLIC_KEY;
+uint8_t *feature_verification_key =
+    (uint8_t *)image_secrets.signing_public_key;
+
+// START message encrypted while idle, so that it can go out as soon as the
+// car acks the unlock. Stale after any change to the fob state.
+PREPARED_MESSAGE start_message;
+
+// Fob state being written to flash by the main loop, kept apart from the state
+// in ram, which may change again before the write is done, and the host reply
+// to send once it is
+FLASH_DATA fob_state_commit;
+FLASH_WRITE fob_state_write;
+const char *fob_state_reply;
+
+// Kept in hibernation memory while the fob hibernates
+RESUME_RECORD resume_record;
+
+// Timer 0 value when the last handshake request started going out
+uint32_t handshake_sent;
 
 /**
  * @brief Main function for the fob example
@@ -104,7 +137,9 @@ uint8_t *feature_verification_key = SIGNING_PUBLIC_KEY;
  * based on firmware build.
  */
 int main(void) {
-  FLASH_DATA fob_state_ram;
+  // Zeroed so that a newly paired or provisioned state starts with no
+  // features, rather than whatever was left on the (painted) stack
+  FLASH_DATA fob_state_ram = {0};
   FLASH_DATA *fob_state_flash = (FLASH_DATA *)FOB_STATE_PTR;
 
   // Lock down unused board functionality
@@ -113,44 +148,77 @@ int main(void) {
   // Initialize UART (early for debugging)
   uart_init();
 
-  // Initialize libhydrogen
+  // Refuse to run from an unstamped template or a corrupted image
+  if (!image_secrets_valid()) {
+    debug_print("\r\nERROR: Secrets section not provisioned");
+    while (true)
+      ;
+  }
+
+  // Initialize board link UART, so that its timer can time the rest of the
+  // boot
+  setup_board_link(BOARD_LINK_MODE);
+  uint32_t link_start = TimerValueGet(TIMER0_BASE, TIMER_A);
+
+  // A wake button press while hibernating is an unlock, which is requested
+  // before any host output
+  bool resumed = resume_check(&resume_record);
+
+  // Initialize libhydrogen, timing its entropy harvest
+  uint32_t boot_start = TimerValueGet(TIMER0_BASE, TIMER_A);
   hydro_init();
+  uint32_t hydro_ticks = boot_start - TimerValueGet(TIMER0_BASE, TIMER_A);
 
-// If paired fob, initialize the system information and save to flash
-#if PAIRED == 1
-  if (fob_state_flash->paired == FLASH_UNPAIRED) {
-    strcpy((char *)(fob_state_ram.pair_info.pin), PAIR_PIN);
-    fob_state_ram.pair_info.car_id = CAR_ID;
-    fob_state_ram.feature_info.car_id = CAR_ID;
+  // If paired fob, initialize the system information and save to flash
+  if (image_secrets.paired) {
+    if (fob_state_flash->paired == FLASH_UNPAIRED) {
+      memcpy(fob_state_ram.pair_info.pin, (uint8_t *)image_secrets.pair_pin,
+             sizeof(fob_state_ram.pair_info.pin));
+      fob_state_ram.pair_info.car_id = image_secrets.car_id;
+      fob_state_ram.feature_info.car_id = image_secrets.car_id;
 
-    memcpy(&fob_state_ram.pair_info.message_key, message_key,
-           hydro_secretbox_KEYBYTES);
+      memcpy(&fob_state_ram.pair_info.message_key, message_key,
+             hydro_secretbox_KEYBYTES);
 
-    fob_state_ram.paired = FLASH_PAIRED;
+      fob_state_ram.paired = FLASH_PAIRED;
 
-    saveFobState(&fob_state_ram);
+      saveFobState(&fob_state_ram, NULL);
+      commitFobState(true);
+    }
+  } else {
+    fob_state_ram.paired = FLASH_UNPAIRED;
   }
-#else
-  fob_state_ram.paired = FLASH_UNPAIRED;
-#endif
 
   if (fob_state_flash->paired == FLASH_PAIRED) {
-    debug_print("\r\nFob paired to car, loading data");
+    if (!resumed) {
+      debug_print("\r\nFob paired to car, loading data");
+    }
     memcpy(&fob_state_ram, fob_state_flash, FLASH_DATA_SIZE);
 
     message_key = fob_state_ram.pair_info.message_key;
   } else {
+    // Without the car's key there is no unlock to resume with
+    resumed = false;
     debug_print("\r\nFob not paired to car");
   }
 
   // This will run on first boot to initialize features
   if (fob_state_ram.feature_info.num_active == 0xFF) {
     fob_state_ram.feature_info.num_active = 0;
-    saveFobState(&fob_state_ram);
+    saveFobState(&fob_state_ram, NULL);
+    commitFobState(true);
   }
 
-  // Initialize board link UART
-  setup_board_link();
+  // Ready for an unlock: a cold boot waits for SW1, a resumed fob sends its
+  // handshake request right away
+  uint32_t ready_ticks;
+  if (resumed) {
+    requestHandshake();
+    ready_ticks = link_start - handshake_sent;
+  } else {
+    ready_ticks = link_start - TimerValueGet(TIMER0_BASE, TIMER_A);
+    resume_record.cold_ready_ticks = ready_ticks;
+  }
 
   // Setup SW1
   GPIOPinTypeGPIOInput(GPIO_PORTF_BASE, GPIO_PIN_4);
@@ -163,55 +231,120 @@ int main(void) {
   GPIOPinWrite(GPIO_PORTF_BASE, GPIO_PIN_3, GPIO_PIN_3); // g
 
   // Declare a buffer for reading and writing to UART
-  uint8_t uart_buffer[10];
+  uint8_t uart_buffer[16];
   uint8_t uart_buffer_index = 0;
 
   uint8_t previous_sw_state = GPIO_PIN_4;
   uint8_t debounce_sw_state = GPIO_PIN_4;
   uint8_t current_sw_state = GPIO_PIN_4;
 
+  if (resumed) {
+    unlockAndStart(&fob_state_ram, true);
+  }
+  boot_report(hydro_ticks, ready_ticks, resumed);
+
   // Infinite loop for polling UART
   while (true) {
 
     // Non blocking UART polling
     if (uart_avail(HOST_UART)) {
       uint8_t uart_char = (uint8_t)uart_readb(HOST_UART);
+      resume_idle_reset();
 
       if ((uart_char != '\r') && (uart_char != '\n') && (uart_char != '\0') &&
           (uart_char != 0xD)) {
-        uart_buffer[uart_buffer_index] = uart_char;
-        uart_buffer_index++;
+        // Drop characters past the end of the longest command
+        if (uart_buffer_index < sizeof(uart_buffer) - 1) {
+          uart_buffer[uart_buffer_index] = uart_char;
+          uart_buffer_index++;
+        }
       } else {
         uart_buffer[uart_buffer_index] = 0x00;
         uart_buffer_index = 0;
 
         if (!(strcmp((char *)uart_buffer, "enable"))) {
           enableFeature(&fob_state_ram);
+        } else if (!(strcmp((char *)uart_buffer, "enable-batch"))) {
+          enableFeatureBatch(&fob_state_ram);
         } else if (!(strcmp((char *)uart_buffer, "pair"))) {
           pairFob(&fob_state_ram);
+        } else if (!(strcmp((char *)uart_buffer, "stack"))) {
+          stack_report();
+        } else if (!(strcmp((char *)uart_buffer, "link"))) {
+          board_link_report();
+        } else if (!(strcmp((char *)uart_buffer, "hibernate"))) {
+          hibernateFob();
         }
       }
     }
 
+    // Write the next part of a state change to flash between host UART polls,
+    // so that commands are not held up by a whole page rewrite. SW1 is read,
+    // and the START message prepared, once the state is in flash.
+    if (commitFobState(false)) {
+      continue;
+    }
+
+    // Nothing to do for HIBERNATE_IDLE_S, sleep until the wake button
+    if (fob_state_ram.paired == FLASH_PAIRED && resume_idle_expired()) {
+      hibernateFob();
+    }
+
     current_sw_state = GPIOPinRead(GPIO_PORTF_BASE, GPIO_PIN_4);
     if ((current_sw_state != previous_sw_state) && (current_sw_state == 0)) {
+      uint32_t press = TimerValueGet(TIMER0_BASE, TIMER_A);
+
       // Debounce switch
       for (int i = 0; i < 10000; i++)
         ;
       debounce_sw_state = GPIOPinRead(GPIO_PORTF_BASE, GPIO_PIN_4);
       if (debounce_sw_state == current_sw_state) {
-        debug_print("\r\nUnlocking car");
-        unlockCar(&fob_state_ram);
-
-        debug_print("\r\nWaiting for ack");
-        if (receiveAck()) {
-          debug_print("\r\nAck received, starting car");
-          startCar(&fob_state_ram);
+        // Only a paired fob sends a handshake request for the press
+        if (unlockAndStart(&fob_state_ram, false)) {
+          unlock_report(press - handshake_sent);
         }
+        resume_idle_reset();
       }
     }
     previous_sw_state = current_sw_state;
+
+    // Nothing else to do, so encrypt the next START message. Each one is only
+    // sent once, so every unlock gets a fresh ciphertext.
+    if (!start_message.ready && fob_state_ram.paired == FLASH_PAIRED) {
+      prepareStart(&fob_state_ram);
+    }
+  }
+}
+
+/**
+ * @brief Function that unlocks and starts the car, for an SW1 or wake button
+ * press
+ *
+ * @param fob_state_ram pointer to the current fob state in ram
+ * @param requested true if the handshake request has been sent already
+ * @return true if the fob is paired and performed the handshake
+ */
+bool unlockAndStart(FLASH_DATA *fob_state_ram, bool requested) {
+  debug_print("\r\nUnlocking car");
+  bool unlocked = unlockCar(fob_state_ram, requested);
+
+  debug_print("\r\nWaiting for ack");
+  if (receiveAck()) {
+    debug_print("\r\nAck received, starting car");
+    startCar(fob_state_ram);
   }
+
+  return unlocked;
+}
+
+/**
+ * @brief Function that hibernates the fob until the wake button is pressed,
+ * once its state is in flash
+ */
+void hibernateFob(void) {
+  debug_print("\r\nHibernating");
+  commitFobState(true);
+  resume_hibernate(&resume_record);
 }
 
 /**
@@ -227,6 +360,7 @@ void pairFob(FLASH_DATA *fob_state_ram) {
   if (fob_state_ram->paired == FLASH_PAIRED) {
     int16_t bytes_read;
     uint8_t uart_buffer[8];
+    uart_writeb(HOST_UART, PAIR_PROMPT_PREFIX);
     uart_write(HOST_UART, (uint8_t *)"P", 1);
     bytes_read = uart_readline(HOST_UART, uart_buffer);
 
@@ -250,11 +384,12 @@ void pairFob(FLASH_DATA *fob_state_ram) {
     receive_board_message_by_type(&message, PAIR_MAGIC);
     fob_state_ram->paired = FLASH_PAIRED;
 
-    fob_state_ram->feature_info.car_id = fob_state_ram->pair_info.car_id;
+    // Unlock with the car's key from now on, without waiting for a reset
+    message_key = fob_state_ram->pair_info.message_key;
 
-    uart_write(HOST_UART, (uint8_t *)"Paired", 6);
+    fob_state_ram->feature_info.car_id = fob_state_ram->pair_info.car_id;
 
-    saveFobState(fob_state_ram);
+    saveFobState(fob_state_ram, "Paired");
   }
 }
 
@@ -266,74 +401,147 @@ void pairFob(FLASH_DATA *fob_state_ram) {
 void enableFeature(FLASH_DATA *fob_state_ram) {
   debug_print("\r\n\n---- Enable Feature ----\n");
   if (fob_state_ram->paired == FLASH_PAIRED) {
-    uint8_t uart_buffer[256];
-    uart_readline(HOST_UART, uart_buffer);
+    ENABLE_PACKET enable_message;
 
-    uint8_t decoded_buffer[128];
-
-    hydro_hex2bin(decoded_buffer, 128, uart_buffer, 138, 0, 0);
-
-    ENABLE_PACKET *enable_message = (ENABLE_PACKET *)decoded_buffer;
-
-    // If feature is intended for a different car, exit
-    if (fob_state_ram->pair_info.car_id != enable_message->car_id) {
+    // If package is malformed, exit
+    if (!receiveEnablePacket(&enable_message)) {
+      debug_print("\r\nERROR: Malformed feature package.");
       return;
     }
 
-    // If feature list full, exit
-    if (fob_state_ram->feature_info.num_active == NUM_FEATURES) {
+    if (applyEnablePacket(fob_state_ram, &enable_message) != ENABLE_OK) {
       return;
     }
 
-    // If feature already enabled, exit
-    for (int i = 0; i < fob_state_ram->feature_info.num_active; i++) {
-      if (fob_state_ram->feature_info.features[i] == enable_message->feature) {
-        return;
+    saveFobState(fob_state_ram, "Enabled");
+  }
+}
+
+/**
+ * @brief Function that handles enabling several features in one transaction
+ *
+ * Reads a package count byte followed by that many packages. Every package is
+ * verified and applied to the state in ram, then flash is written once. An
+ * ENABLE_* status character, after ENABLE_STATUS_PREFIX, is returned as each
+ * package is processed, which also tells the host it can send the next one
+ * without overrunning the UART FIFO during verification. "Batch" is sent once
+ * the state is committed, or right away if no feature was enabled.
+ *
+ * @param fob_state_ram pointer to the current fob state in ram
+ */
+void enableFeatureBatch(FLASH_DATA *fob_state_ram) {
+  debug_print("\r\n\n---- Enable Feature Batch ----\n");
+  if (fob_state_ram->paired == FLASH_PAIRED) {
+    uint8_t num_packages = (uint8_t)uart_readb(HOST_UART);
+    bool changed = false;
+
+    for (int i = 0; i < num_packages; i++) {
+      ENABLE_PACKET enable_message;
+      uint8_t status;
+
+      if (!receiveEnablePacket(&enable_message)) {
+        status = ENABLE_MALFORMED;
+      } else {
+        status = applyEnablePacket(fob_state_ram, &enable_message);
       }
+
+      changed |= (status == ENABLE_OK);
+      uart_writeb(HOST_UART, ENABLE_STATUS_PREFIX);
+      uart_writeb(HOST_UART, status);
     }
 
-    // If feature signature invalid, exit
-    if (hydro_sign_verify(enable_message->signature, enable_message,
-                          sizeof(enable_message->car_id) +
-                              sizeof(enable_message->feature),
-                          "feature", feature_verification_key) != 0) {
-      debug_print("\r\nERROR: Feature verification failed.");
-      return;
+    if (changed) {
+      saveFobState(fob_state_ram, "Batch");
+    } else {
+      uart_write(HOST_UART, (uint8_t *)"Batch", 5);
     }
+  }
+}
 
-    // Set feature enabled, store signature (to be verified by car)
-    fob_state_ram->feature_info
-        .features[fob_state_ram->feature_info.num_active] =
-        enable_message->feature;
+/**
+ * @brief Function that validates a feature package and enables the feature in
+ * ram. The caller is responsible for saving the state to flash.
+ *
+ * @param fob_state_ram pointer to the current fob state in ram
+ * @param enable_message pointer to the received feature package
+ * @return uint8_t ENABLE_OK if the feature was enabled, otherwise the reason
+ */
+uint8_t applyEnablePacket(FLASH_DATA *fob_state_ram,
+                          ENABLE_PACKET *enable_message) {
+  // If feature is intended for a different car, exit
+  if (fob_state_ram->pair_info.car_id != enable_message->car_id) {
+    return ENABLE_WRONG_CAR;
+  }
 
-    memcpy(fob_state_ram->feature_info
-               .signatures[fob_state_ram->feature_info.num_active],
-           enable_message->signature, hydro_sign_BYTES);
+  // If feature list full, exit
+  if (fob_state_ram->feature_info.num_active >= NUM_FEATURES) {
+    return ENABLE_FULL;
+  }
 
-    fob_state_ram->feature_info.num_active++;
+  // If feature already enabled, exit
+  for (int i = 0; i < fob_state_ram->feature_info.num_active; i++) {
+    if (fob_state_ram->feature_info.features[i] == enable_message->feature) {
+      return ENABLE_DUPLICATE;
+    }
+  }
 
-    saveFobState(fob_state_ram);
-    uart_write(HOST_UART, (uint8_t *)"Enabled", 7);
+  // If feature signature invalid, exit
+  if (hydro_sign_verify(enable_message->signature, enable_message,
+                        sizeof(enable_message->car_id) +
+                            sizeof(enable_message->feature),
+                        "feature", feature_verification_key) != 0) {
+    debug_print("\r\nERROR: Feature verification failed.");
+    return ENABLE_BAD_SIGNATURE;
   }
+
+  // Set feature enabled, store signature (to be verified by car)
+  fob_state_ram->feature_info
+      .features[fob_state_ram->feature_info.num_active] =
+      enable_message->feature;
+
+  memcpy(fob_state_ram->feature_info
+             .signatures[fob_state_ram->feature_info.num_active],
+         enable_message->signature, hydro_sign_BYTES);
+
+  fob_state_ram->feature_info.num_active++;
+
+  return ENABLE_OK;
+}
+
+/**
+ * @brief Function that sends the fob's handshake request to the car
+ */
+void requestHandshake(void) {
+  MESSAGE_PACKET message;
+
+  uint8_t buffer[1];
+  message.buffer = buffer;
+
+  message.magic = HANDSHAKE_MAGIC;
+  message.message_len = 0;
+
+  // Before sending, which waits for the car's link ack
+  handshake_sent = TimerValueGet(TIMER0_BASE, TIMER_A);
+  send_board_message(&message);
 }
 
 /**
  * @brief Function implementing simple handshake between fob and car. Returns
  * nonce to be used when processing unlock packet.
+ *
+ * @param requested true if the handshake request has been sent already
  */
-uint32_t performHandshake(void) {
+uint32_t performHandshake(bool requested) {
   debug_print("\r\nPerforming Handshake");
   // Create a message struct variable for receiving data
   MESSAGE_PACKET message;
   uint8_t buffer[256];
   message.buffer = buffer;
 
-  debug_print("\r\nSending handshake request");
-
-  message.magic = HANDSHAKE_MAGIC;
-  message.message_len = 0;
-
-  send_board_message(&message);
+  if (!requested) {
+    debug_print("\r\nSending handshake request");
+    requestHandshake();
+  }
 
   debug_print("\r\nWaiting for response packet");
 
@@ -352,15 +560,17 @@ uint32_t performHandshake(void) {
  * @brief Function that handles the fob unlocking a car
  *
  * @param fob_state_ram pointer to the current fob state in ram
+ * @param requested true if the handshake request has been sent already
+ * @return true if the fob is paired and performed the handshake
  */
-void unlockCar(FLASH_DATA *fob_state_ram) {
+bool unlockCar(FLASH_DATA *fob_state_ram, bool requested) {
   debug_print("\r\n\n---- Begin Unlock ----\n");
   if (fob_state_ram->paired == FLASH_PAIRED) {
     MESSAGE_PACKET message;
     uint8_t buffer[256];
     message.buffer = buffer;
 
-    uint32_t nonce = performHandshake();
+    uint32_t nonce = performHandshake(requested);
 
     debug_print("\r\n\n---- Send Unlock ----\n");
 
@@ -372,7 +582,10 @@ void unlockCar(FLASH_DATA *fob_state_ram) {
     message.magic = UNLOCK_MAGIC;
 
     send_board_message(&message);
+    return true;
   }
+
+  return false;
 }
 
 /**
@@ -383,22 +596,71 @@ void unlockCar(FLASH_DATA *fob_state_ram) {
 void startCar(FLASH_DATA *fob_state_ram) {
   debug_print("\r\n\n---- Start ----\n");
   if (fob_state_ram->paired == FLASH_PAIRED) {
-    MESSAGE_PACKET message;
-    message.magic = START_MAGIC;
-    message.message_len = sizeof(FEATURE_DATA);
-    message.buffer = (uint8_t *)&fob_state_ram->feature_info;
-    send_board_message(&message);
+    // Only when unlocking right after a state change or another unlock
+    if (!start_message.ready) {
+      prepareStart(fob_state_ram);
+    }
+    send_prepared_message(&start_message);
   }
 }
 
 /**
- * @brief Function that erases and rewrites the non-volatile data to flash
+ * @brief Function that encrypts the START message ahead of time
  *
- * @param info Pointer to the flash data ram
+ * @param fob_state_ram pointer to the current fob state in ram
  */
-void saveFobState(FLASH_DATA *flash_data) {
-  FlashErase(FOB_STATE_PTR);
-  FlashProgram((uint32_t *)flash_data, FOB_STATE_PTR, FLASH_DATA_SIZE);
+void prepareStart(FLASH_DATA *fob_state_ram) {
+  MESSAGE_PACKET message;
+  message.magic = START_MAGIC;
+  message.message_len = sizeof(FEATURE_DATA);
+  message.buffer = (uint8_t *)&fob_state_ram->feature_info;
+  prepare_board_message(&start_message, &message);
+}
+
+/**
+ * @brief Function that starts writing the non-volatile data to flash
+ *
+ * The write is carried out by commitFobState. One still in progress is
+ * finished first, so that replies go out in order.
+ *
+ * @param flash_data Pointer to the flash data ram
+ * @param reply Host reply to send once the data is in flash, or NULL
+ */
+void saveFobState(FLASH_DATA *flash_data, const char *reply) {
+  // Features, pairing or the key may have changed
+  start_message.ready = false;
+
+  commitFobState(true);
+
+  memcpy(&fob_state_commit, flash_data, FLASH_DATA_SIZE);
+  fob_state_reply = reply;
+  flash_write_start(&fob_state_write, FOB_STATE_PTR, &fob_state_commit,
+                    FLASH_DATA_SIZE);
+}
+
+/**
+ * @brief Function that writes the next part of a saved state to flash, and
+ * sends its host reply once all of it is written
+ *
+ * @param wait true to write all of what is left
+ * @return bool true if the write is still in progress
+ */
+bool commitFobState(bool wait) {
+  if (!fob_state_write.busy) {
+    return false;
+  }
+
+  if (wait) {
+    flash_write_finish(&fob_state_write);
+  } else if (flash_write_step(&fob_state_write)) {
+    return true;
+  }
+
+  if (fob_state_reply != NULL) {
+    uart_write(HOST_UART, (uint8_t *)fob_state_reply, strlen(fob_state_reply));
+    fob_state_reply = NULL;
+  }
+  return false;
 }
 
 /**
@@ -417,3 +679,140 @@ uint8_t receiveAck() {
 
   return message.buffer[0];
 }
+
+/**
+ * @brief Function that converts a hex character to its value
+ *
+ * @param c the hex character
+ * @return int8_t value of the character, or -1 if it is not a hex digit
+ */
+static int8_t hexNibble(uint8_t c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  } else if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  } else if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+/**
+ * @brief Function that receives a feature package from the host
+ *
+ * Binary packages are PACKAGE_BINARY_MAGIC, a version byte, a length byte and
+ * the raw ENABLE_PACKET, read straight into the packet. Legacy packages are a
+ * single line of hex, decoded two characters at a time as they arrive. Either
+ * way no more than one packet worth of data is ever stored.
+ *
+ * @param enable_message pointer to the packet to fill
+ * @return bool true if a complete, well-formed packet was received
+ */
+bool receiveEnablePacket(ENABLE_PACKET *enable_message) {
+  uint8_t *packet = (uint8_t *)enable_message;
+  uint8_t c = (uint8_t)uart_readb(HOST_UART);
+
+  if (c == PACKAGE_BINARY_MAGIC) {
+    uint8_t version = (uint8_t)uart_readb(HOST_UART);
+    uint8_t length = (uint8_t)uart_readb(HOST_UART);
+
+    if ((version != PACKAGE_VERSION) || (length != sizeof(ENABLE_PACKET))) {
+      // Discard the payload, at most 255 bytes, so that it is not taken for
+      // the next package or for commands
+      for (uint32_t i = 0; i < length; i++) {
+        uart_readb(HOST_UART);
+      }
+      return false;
+    }
+
+    uart_read(HOST_UART, packet, length);
+    return true;
+  }
+
+  // Legacy hex package - consume the whole line even if it is malformed so
+  // that the remainder is not interpreted as commands
+  bool valid = true;
+  uint32_t nibbles = 0;
+
+  while ((c != '\n') && (c != '\r')) {
+    int8_t nibble = hexNibble(c);
+
+    if ((nibble < 0) || (nibbles == 2 * sizeof(ENABLE_PACKET))) {
+      valid = false;
+    } else if (nibbles % 2 == 0) {
+      packet[nibbles / 2] = nibble << 4;
+      nibbles++;
+    } else {
+      packet[nibbles / 2] |= nibble;
+      nibbles++;
+    }
+
+    c = (uint8_t)uart_readb(HOST_UART);
+  }
+
+  return valid && (nibbles == 2 * sizeof(ENABLE_PACKET));
+}
+
+#ifdef UNLOCK_REPORT
+/**
+ * @brief Function that writes system clock ticks and milliseconds in hex
+ *
+ * @param ticks system clock ticks
+ */
+static void writeTicks(uint32_t ticks) {
+  uart_write(HOST_UART, (uint8_t *)" ticks ", 7);
+  uart_write_hex_u32(HOST_UART, ticks);
+  uart_write(HOST_UART, (uint8_t *)" ms ", 4);
+  uart_write_hex_u32(HOST_UART, ticks / (SysCtlClockGet() / 1000));
+}
+#endif
+
+/**
+ * @brief Write the time hydro_init took at boot, and the time until the fob
+ * was ready to unlock, to the host UART
+ *
+ * The entropy harvest in hydro_init is most of the time from reset until the
+ * board is ready for an unlock, so this is the figure to watch when changing
+ * the boot sequence. A resumed fob writes this after its unlock, and compares
+ * the time until it starts sending its handshake request with the time the
+ * last cold boot took to get ready. Only written by builds with UNLOCK_REPORT,
+ * as the host tools do not expect it.
+ *
+ * @param hydro_ticks system clock ticks spent in hydro_init
+ * @param ready_ticks system clock ticks from board link setup to ready, or to
+ * the handshake request if resumed
+ * @param resumed true if the fob resumed from hibernation
+ */
+void boot_report(uint32_t hydro_ticks, uint32_t ready_ticks, bool resumed) {
+#ifdef UNLOCK_REPORT
+  uart_write(HOST_UART, (uint8_t *)"\r\nBoot: hydro_init", 18);
+  writeTicks(hydro_ticks);
+
+  if (resumed) {
+    uart_write(HOST_UART, (uint8_t *)"\r\nBoot: resume first frame", 26);
+    writeTicks(ready_ticks);
+    uart_write(HOST_UART, (uint8_t *)" cold ready", 11);
+    writeTicks(resume_record.cold_ready_ticks);
+  } else {
+    uart_write(HOST_UART, (uint8_t *)"\r\nBoot: cold ready", 18);
+    writeTicks(ready_ticks);
+  }
+#endif
+}
+
+/**
+ * @brief Write the time from an SW1 press to its handshake request to the
+ * host UART
+ *
+ * Added to the cold ready time of boot_report, this is what a cold boot
+ * takes to its first frame, to compare with a resume. Only written by builds
+ * with UNLOCK_REPORT.
+ *
+ * @param ticks system clock ticks from the press to the handshake request
+ */
+void unlock_report(uint32_t ticks) {
+#ifdef UNLOCK_REPORT
+  uart_write(HOST_UART, (uint8_t *)"\r\nUnlock: press to first frame", 30);
+  writeTicks(ticks);
+#endif
+}
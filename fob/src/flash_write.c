@@ -0,0 +1,82 @@
+/**
+ * @file flash_write.c
+ * @brief Flash page rewrites split into short steps
+ * @date 2023
+ *
+ * The erase and program routines come from the TivaWare ROM (MAP_ calls for
+ * TARGET_IS_TM4C123_RB1), which is fetched from while the flash is busy, so
+ * a step never stalls the CPU, only the caller waits for it. Off the board,
+ * MAP_ calls are the driverlib functions.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "driverlib/flash.h"
+#include "driverlib/rom.h"
+#include "driverlib/rom_map.h"
+
+#include "flash_write.h"
+
+/**
+ * @brief Start rewriting a flash page, replacing any rewrite in progress
+ *
+ * The page is erased again even if an earlier rewrite had got past its
+ * erase, since programming can only clear bits.
+ *
+ * @param write the rewrite
+ * @param address start of the page
+ * @param data word-aligned data to write at its start
+ * @param length length of data, a multiple of 4
+ */
+void flash_write_start(FLASH_WRITE *write, uint32_t address, const void *data,
+                       uint32_t length) {
+  write->data = data;
+  write->address = address;
+  write->length = length;
+  write->written = 0;
+  write->erased = false;
+  write->busy = true;
+}
+
+/**
+ * @brief Run the next step of a rewrite
+ *
+ * The first step erases the page, and every later one programs up to
+ * FLASH_WRITE_CHUNK bytes.
+ *
+ * @param write the rewrite
+ * @return bool true if steps remain
+ */
+bool flash_write_step(FLASH_WRITE *write) {
+  if (!write->busy) {
+    return false;
+  }
+
+  if (!write->erased) {
+    MAP_FlashErase(write->address);
+    write->erased = true;
+  } else {
+    uint32_t chunk = write->length - write->written;
+    if (chunk > FLASH_WRITE_CHUNK) {
+      chunk = FLASH_WRITE_CHUNK;
+    }
+
+    MAP_FlashProgram((uint32_t *)(write->data + write->written),
+                     write->address + write->written, chunk);
+    write->written += chunk;
+  }
+
+  write->busy = (write->written < write->length);
+  return write->busy;
+}
+
+/**
+ * @brief Run every remaining step of a rewrite
+ *
+ * @param write the rewrite
+ */
+void flash_write_finish(FLASH_WRITE *write) {
+  while (flash_write_step(write))
+    ;
+}
@@ -0,0 +1,112 @@
+/**
+ * @file resume.c
+ * @brief Hibernation of the fob between unlocks, and resume on the wake button
+ * @date 2023
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "inc/hw_memmap.h"
+
+#include "driverlib/hibernate.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/timer.h"
+#include "driverlib/uart.h"
+
+#include "resume.h"
+#include "uart.h"
+
+#define RESUME_MAGIC 0x48424F46 // "FOBH"
+#define RESUME_WORDS (sizeof(RESUME_RECORD) / sizeof(uint32_t))
+
+// Timer 0 value from which whole idle seconds are counted, and their count
+static uint32_t idle_mark;
+static uint32_t idle_seconds;
+
+/**
+ * @brief Find out whether the fob is resuming from hibernation
+ *
+ * The hibernation module stays active through a reset while it has power, so
+ * only a wake by the WAKE pin is a resume. Its clock is enabled on every
+ * boot, so that the 32 kHz oscillator has settled by the time the fob next
+ * hibernates.
+ *
+ * @param record filled with the record kept in hibernation, or zeroed
+ * @return bool true if woken by the wake button with a record kept
+ */
+bool resume_check(RESUME_RECORD *record) {
+  uint32_t status = 0;
+
+  memset(record, 0, sizeof(*record));
+  SysCtlPeripheralEnable(SYSCTL_PERIPH_HIBERNATE);
+
+  if (HibernateIsActive()) {
+    status = HibernateIntStatus(false);
+    HibernateIntClear(status);
+    HibernateDataGet((uint32_t *)record, RESUME_WORDS);
+
+    if (record->magic != RESUME_MAGIC) {
+      memset(record, 0, sizeof(*record));
+    }
+  }
+
+  HibernateEnableExpClk(SysCtlClockGet());
+  resume_idle_reset();
+
+  return (record->magic == RESUME_MAGIC) && (status & HIBERNATE_INT_PIN_WAKE);
+}
+
+/**
+ * @brief Hibernate until the wake button is pressed
+ *
+ * Waits for the host UART to send what it holds first. The part is powered
+ * down during the request, so this never returns.
+ *
+ * @param record the record to keep in hibernation
+ */
+void resume_hibernate(RESUME_RECORD *record) {
+  record->magic = RESUME_MAGIC;
+  record->hibernations++;
+
+  while (UARTBusy(HOST_UART))
+    ;
+
+  HibernateDataSet((uint32_t *)record, RESUME_WORDS);
+  HibernateWakeSet(HIBERNATE_WAKE_PIN);
+  HibernateRequest();
+
+  while (true)
+    ;
+}
+
+/**
+ * @brief Restart the idle time that leads to hibernation
+ */
+void resume_idle_reset(void) {
+  idle_mark = TimerValueGet(TIMER0_BASE, TIMER_A);
+  idle_seconds = 0;
+}
+
+/**
+ * @brief Check whether the fob has been idle for HIBERNATE_IDLE_S
+ *
+ * Whole seconds are counted as they pass, as timer 0 wraps every 53 seconds.
+ *
+ * @return bool true once the fob has been idle long enough
+ */
+bool resume_idle_expired(void) {
+  if (HIBERNATE_IDLE_S == 0) {
+    return false;
+  }
+
+  uint32_t second = SysCtlClockGet();
+  if (idle_mark - TimerValueGet(TIMER0_BASE, TIMER_A) >= second) {
+    idle_mark -= second;
+    idle_seconds++;
+  }
+
+  return idle_seconds >= HIBERNATE_IDLE_S;
+}
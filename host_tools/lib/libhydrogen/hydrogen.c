@@ -0,0 +1,50 @@
+// NOT CRYPTO: local stand-in for libhydrogen so the simulator can be exercised
+#include "hydrogen.h"
+#include <string.h>
+#include <stdio.h>
+#include <sys/random.h>
+static uint64_t mix(const uint8_t *d, size_t n, const uint8_t *k, size_t kn, uint64_t h) {
+  for (size_t i = 0; i < kn; i++) h = (h ^ k[i]) * 0x100000001b3ULL;
+  for (size_t i = 0; i < n; i++) h = (h ^ d[i]) * 0x100000001b3ULL;
+  return h;
+}
+int hydro_init(void) { return 0; }
+void hydro_random_buf(void *out, size_t n) { getrandom(out, n, 0); }
+uint32_t hydro_random_u32(void) { uint32_t v; hydro_random_buf(&v, 4); return v; }
+void hydro_random_buf_deterministic(void *out, size_t n, const uint8_t seed[32]) { uint64_t h = mix(seed,32,0,0,1469598103934665603ULL); for (size_t i=0;i<n;i++){h=h*6364136223846793005ULL+1;((uint8_t*)out)[i]=h>>56;} }
+void hydro_random_ratchet(void) {}
+void hydro_random_reseed(void) {}
+int hydro_hash_hash(uint8_t *out, size_t out_len, const void *in, size_t in_len, const char ctx[8], const uint8_t key[32]) {
+  uint64_t h = mix(in, in_len, (const uint8_t*)ctx, 8, 1469598103934665603ULL);
+  if (key) h = mix(key, 32, 0, 0, h);
+  for (size_t i = 0; i < out_len; i++) { h = h * 6364136223846793005ULL + 1442695040888963407ULL; out[i] = h >> 56; }
+  return 0;
+}
+void hydro_secretbox_keygen(uint8_t key[32]) { hydro_random_buf(key, 32); }
+static void tag(uint8_t t[16], const uint8_t *hdr, const uint8_t *m, size_t mlen, uint64_t id, const char ctx[8], const uint8_t *key) {
+  uint8_t k2[60]; memcpy(k2, key, 32); memcpy(k2+32, hdr, 20); memcpy(k2+52, &id, 8);
+  hydro_hash_hash(t, 16, m, mlen, ctx, k2);
+  uint64_t h = mix(k2, 60, m, mlen, 7); memcpy(t, &h, 8);
+}
+int hydro_secretbox_encrypt(uint8_t *c, const void *m, size_t mlen, uint64_t id, const char ctx[8], const uint8_t key[32]) {
+  hydro_random_buf(c, 20); memmove(c + 36, m, mlen); tag(c + 20, c, c + 36, mlen, id, ctx, key);
+  uint8_t ks[256]; hydro_hash_hash(ks, mlen, c, 20, ctx, key); for (size_t i=0;i<mlen;i++) c[36+i]^=ks[i];
+  return 0;
+}
+int hydro_secretbox_decrypt(void *m, const uint8_t *c, size_t clen, uint64_t id, const char ctx[8], const uint8_t key[32]) {
+  if (clen < 36) return -1; size_t mlen = clen - 36; uint8_t t[16]; uint8_t p[256];
+  uint8_t ks[256]; hydro_hash_hash(ks, mlen, c, 20, ctx, key); for (size_t i=0;i<mlen;i++) p[i]=c[36+i]^ks[i];
+  tag(t, c, p, mlen, id, ctx, key); if (memcmp(t, c + 20, 16)) return -1; memcpy(m, p, mlen); return 0;
+}
+int hydro_kdf_derive_from_key(uint8_t *sub, size_t n, uint64_t id, const char ctx[8], const uint8_t key[32]) { uint8_t k[40]; memcpy(k,key,32); memcpy(k+32,&id,8); return hydro_hash_hash(sub, n, k, 40, ctx, 0); }
+void hydro_kdf_keygen(uint8_t key[32]) { hydro_random_buf(key, 32); }
+void hydro_sign_keygen(hydro_sign_keypair *kp) { hydro_random_buf(kp->sk, 32); hydro_hash_hash(kp->pk, 32, kp->sk, 32, "pk______", 0); memcpy(kp->sk + 32, kp->pk, 32); }
+int hydro_sign_create(uint8_t sig[64], const void *m, size_t n, const char ctx[8], const uint8_t sk[64]) { return hydro_hash_hash(sig, 64, m, n, ctx, sk + 32); }
+int hydro_sign_verify(const uint8_t sig[64], const void *m, size_t n, const char ctx[8], const uint8_t pk[32]) { uint8_t s[64]; hydro_hash_hash(s, 64, m, n, ctx, pk); volatile int x=0; for (int r=0;r<2000;r++) x+=r; return memcmp(s, sig, 64) ? -1 : 0; }
+void hydro_memzero(void *p, size_t n) { memset(p, 0, n); }
+bool hydro_equal(const void *a, const void *b, size_t n) { return memcmp(a, b, n) == 0; }
+char *hydro_bin2hex(char *hex, size_t max, const uint8_t *bin, size_t n) { if (max < 2*n+1) return NULL; for (size_t i=0;i<n;i++) sprintf(hex+2*i, "%02x", bin[i]); hex[2*n]=0; return hex; }
+int hydro_hex2bin(uint8_t *bin, size_t max, const char *hex, size_t hl, const char *ig, const char **end) { size_t o=0; for (size_t i=0;i+1<hl && o<max;i+=2){unsigned v; if(sscanf(hex+i,"%2x",&v)!=1) return -1; bin[o++]=v;} return (int)o; }
+int hydro_hash_init(hydro_hash_state *st, const char ctx[8], const uint8_t key[32]) { uint64_t h = mix((const uint8_t*)ctx, 8, 0, 0, 1469598103934665603ULL); if (key) h = mix(key, 32, 0, 0, h); memcpy(st->state, &h, 8); return 0; }
+int hydro_hash_update(hydro_hash_state *st, const void *in, size_t n) { uint64_t h; memcpy(&h, st->state, 8); h = mix(in, n, 0, 0, h); memcpy(st->state, &h, 8); return 0; }
+int hydro_hash_final(hydro_hash_state *st, uint8_t *out, size_t n) { uint64_t h; memcpy(&h, st->state, 8); for (size_t i = 0; i < n; i++) { h = h * 6364136223846793005ULL + 1442695040888963407ULL; out[i] = h >> 56; } return 0; }
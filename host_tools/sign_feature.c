@@ -20,12 +20,18 @@ typedef struct {
   uint8_t signature[hydro_sign_BYTES];
 } __attribute__((packed)) SIGNED_FEATURE_PACKAGE;
 
+// Binary package header, must match feature_list.h on the boards
+#define PACKAGE_BINARY_MAGIC 0xFE
+#define PACKAGE_VERSION 1
+
 // Sign a feature package using the provided private key.
 //
 // First arg is car ID,
 // second is feature number,
 // third is secret key filename,
-// fourth is output package filename.
+// fourth is output package filename,
+// optional fifth arg "--hex" writes the legacy hex line format instead of the
+// binary format.
 int main(int argc, char **argv) {
   // Check args
   if (argc < 5) {
@@ -56,9 +62,15 @@ int main(int argc, char **argv) {
                     context, feature_authentication_keypair.sk);
 
   // Output to file
-  FILE *output_file = fopen(argv[4], "w");
-  char output_buffer[1024];
-  hydro_bin2hex(output_buffer, 1024, &s, sizeof(s));
-  fprintf(output_file, "%s\n", output_buffer);
+  FILE *output_file = fopen(argv[4], "wb");
+  if (argc > 5 && strcmp(argv[5], "--hex") == 0) {
+    char output_buffer[1024];
+    hydro_bin2hex(output_buffer, 1024, (uint8_t *)&s, sizeof(s));
+    fprintf(output_file, "%s\n", output_buffer);
+  } else {
+    uint8_t header[3] = {PACKAGE_BINARY_MAGIC, PACKAGE_VERSION, sizeof(s)};
+    fwrite(header, sizeof(header), 1, output_file);
+    fwrite(&s, sizeof(s), 1, output_file);
+  }
   fclose(output_file);
 }
@@ -14,6 +14,10 @@ typedef struct {
   uint8_t signature[hydro_sign_BYTES];
 } __attribute__((packed)) SIGNED_FEATURE_PACKAGE;
 
+// Binary package header, must match feature_list.h on the boards
+#define PACKAGE_BINARY_MAGIC 0xFE
+#define PACKAGE_VERSION 1
+
 int main(int argc, char **argv) {
   // Check args
   if (argc < 3) {
@@ -37,8 +41,31 @@ int main(int argc, char **argv) {
   // Read input from file
   FILE *input_file = fopen(argv[2], "rb");
 
+  // Binary packages carry a header, legacy packages are a line of hex
   SIGNED_FEATURE_PACKAGE s;
-  fread(&s, sizeof(SIGNED_FEATURE_PACKAGE), 1, input_file);
+  uint8_t header[3];
+  if (fread(header, sizeof(header), 1, input_file) != 1) {
+    printf("ERROR: Feature package truncated.\n");
+    return 1;
+  }
+
+  if (header[0] == PACKAGE_BINARY_MAGIC) {
+    if (header[1] != PACKAGE_VERSION || header[2] != sizeof(s) ||
+        fread(&s, sizeof(s), 1, input_file) != 1) {
+      printf("ERROR: Malformed feature package.\n");
+      return 1;
+    }
+  } else {
+    char hex_buffer[1024];
+    memcpy(hex_buffer, header, sizeof(header));
+    if (fgets(hex_buffer + sizeof(header), sizeof(hex_buffer) - sizeof(header),
+              input_file) == NULL ||
+        hydro_hex2bin((uint8_t *)&s, sizeof(s), hex_buffer, sizeof(s) * 2, 0,
+                      0) != sizeof(s)) {
+      printf("ERROR: Malformed feature package.\n");
+      return 1;
+    }
+  }
 
   if (hydro_sign_verify(s.signature, &s,
                         sizeof(s.car_id) + sizeof(s.feature_num), context,
@@ -0,0 +1,358 @@
+/**
+ * @file qemu_hal.c
+ * @brief Board support for running the car and fob on QEMU's lm3s6965evb
+ * @date 2023
+ *
+ * The lm3s6965evb's UARTs, GPIO ports and timer 0 sit at the TM4C123's
+ * addresses and are driven by the real driverlib. Everything else the firmware
+ * touches is taken over here, through the linker's --wrap (see QEMU_WRAP in
+ * the car and fob Makefiles):
+ *
+ *  - Timer 0 counts down at QEMU_CLOCK_HZ from SysTick, as QEMU's general
+ *    purpose timers cannot be read back.
+ *  - EEPROM, which QEMU lacks, is a RAM image filled with placeholder unlock
+ *    and feature messages, as in sim/sim_hal.c.
+ *  - Flash from QEMU_FLASH_BASE is emulated in the half of the lm3s6965's
+ *    SRAM that the TM4C123 does not have. QEMU's flash is read-only, so the
+ *    fob's FOB_STATE_PTR is moved there and starts erased on every run.
+ *  - SW1 is pressed once for every byte received on UART 2.
+ *  - QEMU lacks the hibernation module, so every boot is a cold boot and
+ *    hibernating stops the board.
+ *  - The magic and SysTick time of every board link frame, when its first
+ *    byte is sent or its last byte is taken from the receive ring of uart.c,
+ *    is written to UART 2, so that
+ *    qemu_unlock.py can count the instructions each board spends on each step
+ *    of an unlock.
+ *
+ * QEMU boots from a vector table at address 0, which the board's bootloader
+ * provides on real hardware, so one is added here in front of the image.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "inc/hw_memmap.h"
+
+#include "driverlib/eeprom.h"
+#include "driverlib/gpio.h"
+#include "driverlib/hibernate.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/uart.h"
+
+#include "board_link.h"
+#include "uart.h"
+
+// The lm3s6965evb's system clock in QEMU, which SysTick counts at
+#define QEMU_CLOCK_HZ 200000000
+
+// Emulated flash, just above the TM4C123's 32 KiB of SRAM
+#define QEMU_FLASH_BASE 0x20008000
+#define QEMU_FLASH_SIZE 0x800
+#define QEMU_FLASH_PAGE 0x400
+
+#define QEMU_EEPROM_SIZE 0x800
+
+// Same placement as the unlock message and features in the car firmware
+#define QEMU_UNLOCK_LOC 0x7C0
+#define QEMU_FEATURE_SIZE 64
+#define QEMU_NUM_FEATURES 3
+
+#define QEMU_TRACE_UART UART2_BASE
+
+// Cortex-M SysTick registers
+#define SYST_CSR (*(volatile uint32_t *)0xE000E010)
+#define SYST_RVR (*(volatile uint32_t *)0xE000E014)
+#define SYST_CVR (*(volatile uint32_t *)0xE000E018)
+#define SYST_CSR_ENABLE 0x1
+#define SYST_CSR_TICKINT 0x2
+#define SYST_CSR_CLKSOURCE 0x4
+#define SYSTICK_PERIOD (1 << 24)
+
+/**
+ * @brief A board link frame seen on the board UART, for the trace
+ */
+typedef struct {
+  uint32_t length; // COBS bytes since the last delimiter
+  uint8_t code;    // the first COBS code byte
+  uint8_t magic;
+  uint64_t start; // SysTick time of the first byte
+} QEMU_TRACE_FRAME;
+
+extern uint32_t _stack_top;
+void Firmware_Startup(void);
+
+int32_t __real_GPIOPinRead(uint32_t ui32Port, uint8_t ui8Pins);
+int32_t __real_UARTCharGet(uint32_t ui32Base);
+int32_t __real_uart_readb(uint32_t uart);
+void __real_UARTCharPut(uint32_t ui32Base, unsigned char ucData);
+
+void qemu_reset(void);
+void qemu_fault(void);
+void qemu_systick(void);
+
+// SysTick periods since reset, zeroed by Firmware_Startup along with .bss
+static volatile uint32_t systick_wraps;
+
+static uint32_t timer_load;
+static uint64_t timer_start;
+
+static uint32_t button_reads;
+static bool button_released = true;
+
+static QEMU_TRACE_FRAME tx_frame;
+static QEMU_TRACE_FRAME rx_frame;
+
+static uint8_t eeprom[QEMU_EEPROM_SIZE];
+
+// Initial stack pointer and the exceptions the firmware can raise
+__attribute__((section(".qemu_vectors"), used))
+static const uintptr_t qemu_vectors[16] = {
+    (uintptr_t)&_stack_top,  // initial stack pointer
+    (uintptr_t)qemu_reset,   // reset
+    (uintptr_t)qemu_fault,   // NMI
+    (uintptr_t)qemu_fault,   // hard fault
+    (uintptr_t)qemu_fault,   // memory management fault
+    (uintptr_t)qemu_fault,   // bus fault
+    (uintptr_t)qemu_fault,   // usage fault
+    0,
+    0,
+    0,
+    0,
+    (uintptr_t)qemu_fault,   // SVCall
+    (uintptr_t)qemu_fault,   // debug monitor
+    0,
+    (uintptr_t)qemu_fault,   // PendSV
+    (uintptr_t)qemu_systick, // SysTick
+};
+
+/**
+ * @brief Reset handler: start SysTick and the trace UART, erase the emulated
+ * flash and run the firmware's own startup
+ */
+void qemu_reset(void) {
+  SYST_RVR = SYSTICK_PERIOD - 1;
+  SYST_CVR = 0;
+  SYST_CSR = SYST_CSR_CLKSOURCE | SYST_CSR_TICKINT | SYST_CSR_ENABLE;
+
+  SysCtlPeripheralEnable(SYSCTL_PERIPH_UART2);
+  UARTConfigSetExpClk(
+      QEMU_TRACE_UART, QEMU_CLOCK_HZ, 115200,
+      (UART_CONFIG_WLEN_8 | UART_CONFIG_STOP_ONE | UART_CONFIG_PAR_NONE));
+
+  memset((void *)QEMU_FLASH_BASE, 0xFF, QEMU_FLASH_SIZE);
+
+  Firmware_Startup();
+}
+
+/**
+ * @brief Handler for every unexpected exception, stops the board
+ */
+void qemu_fault(void) {
+  while (true)
+    ;
+}
+
+/**
+ * @brief SysTick handler, extends the 24-bit counter
+ */
+void qemu_systick(void) { systick_wraps++; }
+
+/**
+ * @brief SysTick time since reset
+ *
+ * @return uint64_t ticks at QEMU_CLOCK_HZ
+ */
+static uint64_t qemu_ticks(void) {
+  uint32_t wraps, count;
+
+  // Read again if the counter wrapped in between
+  do {
+    wraps = systick_wraps;
+    count = SYST_CVR;
+  } while (wraps != systick_wraps);
+
+  return (uint64_t)wraps * SYSTICK_PERIOD + (SYSTICK_PERIOD - 1 - count);
+}
+
+/**
+ * @brief Write one trace record: direction, magic and time, in hex
+ *
+ * @param direction 't' for a sent frame, 'r' for a received frame
+ * @param magic the frame's magic
+ * @param ticks the SysTick time
+ */
+static void qemu_trace_write(char direction, uint8_t magic, uint64_t ticks) {
+  static const char hex[] = "0123456789abcdef";
+
+  __real_UARTCharPut(QEMU_TRACE_UART, direction);
+  __real_UARTCharPut(QEMU_TRACE_UART, hex[magic >> 4]);
+  __real_UARTCharPut(QEMU_TRACE_UART, hex[magic & 0xF]);
+  __real_UARTCharPut(QEMU_TRACE_UART, ' ');
+  for (int32_t shift = 60; shift >= 0; shift -= 4) {
+    __real_UARTCharPut(QEMU_TRACE_UART, hex[(ticks >> shift) & 0xF]);
+  }
+  __real_UARTCharPut(QEMU_TRACE_UART, '\n');
+}
+
+/**
+ * @brief Follow the frames on the board UART and trace each complete one
+ *
+ * The magic is the first byte of a frame, which follows the first COBS code
+ * byte unless that code stands for a zero byte.
+ *
+ * @param direction 't' for sent bytes, 'r' for received bytes
+ * @param frame the frame being followed in that direction
+ * @param byte the next byte on the UART
+ */
+static void qemu_trace_byte(char direction, QEMU_TRACE_FRAME *frame,
+                            uint8_t byte) {
+  if (byte == FRAME_DELIMITER) {
+    if (frame->length >= 2) {
+      // Sent frames are timed from their start, received ones from their end
+      qemu_trace_write(direction, frame->magic,
+                       (direction == 't') ? frame->start : qemu_ticks());
+    }
+    frame->length = 0;
+    return;
+  }
+
+  if (frame->length == 0) {
+    frame->code = byte;
+    frame->start = qemu_ticks();
+  } else if (frame->length == 1) {
+    frame->magic = (frame->code == 1) ? 0 : byte;
+  }
+  frame->length++;
+}
+
+/*** driverlib ***/
+
+uint32_t __wrap_SysCtlClockGet(void) { return QEMU_CLOCK_HZ; }
+
+/**
+ * @brief Read SW1 (PF4, active low), pressed by bytes on UART 2
+ *
+ * A press reads low twice, to pass the fob's debounce check, and is followed
+ * by at least one released read.
+ */
+int32_t __wrap_GPIOPinRead(uint32_t ui32Port, uint8_t ui8Pins) {
+  if (ui32Port != GPIO_PORTF_BASE || !(ui8Pins & GPIO_PIN_4)) {
+    return __real_GPIOPinRead(ui32Port, ui8Pins);
+  }
+
+  if (button_reads > 0) {
+    button_reads--;
+    return 0;
+  }
+
+  if (!button_released || !UARTCharsAvail(QEMU_TRACE_UART)) {
+    button_released = true;
+    return ui8Pins;
+  }
+
+  __real_UARTCharGet(QEMU_TRACE_UART);
+  button_reads = 1;
+  button_released = false;
+  return 0;
+}
+
+void __wrap_UARTCharPut(uint32_t ui32Base, unsigned char ucData) {
+  if (ui32Base == BOARD_UART) {
+    qemu_trace_byte('t', &tx_frame, ucData);
+  }
+  __real_UARTCharPut(ui32Base, ucData);
+}
+
+void __wrap_TimerLoadSet(uint32_t ui32Base, uint32_t ui32Timer,
+                         uint32_t ui32Value) {
+  timer_load = ui32Value;
+}
+
+void __wrap_TimerEnable(uint32_t ui32Base, uint32_t ui32Timer) {
+  timer_start = qemu_ticks();
+}
+
+uint32_t __wrap_TimerValueGet(uint32_t ui32Base, uint32_t ui32Timer) {
+  return timer_load - (uint32_t)(qemu_ticks() - timer_start);
+}
+
+/**
+ * @brief Fill the EEPROM with placeholder unlock and feature messages
+ */
+uint32_t __wrap_EEPROMInit(void) {
+  static const char unlock[] = "Emulated car unlocked";
+  static const char feature[] = "Emulated feature 0";
+
+  memset(eeprom, ' ', sizeof(eeprom));
+  memcpy(&eeprom[QEMU_UNLOCK_LOC], unlock, sizeof(unlock) - 1);
+
+  for (uint32_t i = 1; i <= QEMU_NUM_FEATURES; i++) {
+    uint8_t *message = &eeprom[QEMU_UNLOCK_LOC - i * QEMU_FEATURE_SIZE];
+    memcpy(message, feature, sizeof(feature) - 1);
+    message[sizeof(feature) - 2] += i;
+  }
+
+  return EEPROM_INIT_OK;
+}
+
+void __wrap_EEPROMRead(uint32_t *pui32Data, uint32_t ui32Address,
+                       uint32_t ui32Count) {
+  if (ui32Address + ui32Count > sizeof(eeprom)) {
+    qemu_fault();
+  }
+
+  memcpy(pui32Data, &eeprom[ui32Address], ui32Count);
+}
+
+int32_t __wrap_FlashErase(uint32_t ui32Address) {
+  if (ui32Address < QEMU_FLASH_BASE ||
+      ui32Address >= QEMU_FLASH_BASE + QEMU_FLASH_SIZE ||
+      ui32Address % QEMU_FLASH_PAGE) {
+    return -1;
+  }
+
+  memset((void *)ui32Address, 0xFF, QEMU_FLASH_PAGE);
+  return 0;
+}
+
+/**
+ * @brief Program flash, which like the real part can only clear bits
+ */
+int32_t __wrap_FlashProgram(uint32_t *pui32Data, uint32_t ui32Address,
+                            uint32_t ui32Count) {
+  if (ui32Address < QEMU_FLASH_BASE ||
+      ui32Address + ui32Count > QEMU_FLASH_BASE + QEMU_FLASH_SIZE ||
+      ui32Address % 4 || ui32Count % 4) {
+    return -1;
+  }
+
+  uint32_t *flash = (uint32_t *)ui32Address;
+  for (uint32_t i = 0; i < ui32Count / 4; i++) {
+    flash[i] &= pui32Data[i];
+  }
+
+  return 0;
+}
+
+uint32_t __wrap_HibernateIsActive(void) { return 0; }
+
+void __wrap_HibernateEnableExpClk(uint32_t ui32HibClk) {}
+
+void __wrap_HibernateDataSet(uint32_t *pui32Data, uint32_t ui32Count) {}
+
+void __wrap_HibernateWakeSet(uint32_t ui32WakeFlags) {}
+
+void __wrap_HibernateRequest(void) { qemu_fault(); }
+
+/*** uart.c ***/
+
+int32_t __wrap_uart_readb(uint32_t uart) {
+  int32_t byte = __real_uart_readb(uart);
+
+  if (uart == BOARD_UART) {
+    qemu_trace_byte('r', &rx_frame, byte);
+  }
+  return byte;
+}
@@ -0,0 +1,262 @@
+#!/usr/bin/python3 -u
+
+# @file qemu_unlock.py
+# @brief Unlock sequences between a car and a paired fob emulated by QEMU
+# @date 2023
+#
+# Starts the car and fob images built by qemu/Makefile as two lm3s6965evb
+# machines, with their board link UARTs connected over a unix socket, enables
+# --features features on the fob and then presses SW1 --cycles times.
+#
+# QEMU runs with -icount shift=0, so that every instruction takes one
+# nanosecond of virtual time. qemu_hal.c traces the magic and SysTick time of
+# every board link frame on UART 2, which gives the instructions each board
+# runs from one frame to the next frame it sends: the work it does on the
+# frame it has just received, or between two frames it sends. Transitions into
+# the fob's HANDSHAKE request include waiting for the button and are left out.
+#
+# Results are written as JSON: completed and timed out cycles and, for every
+# transition, how often it was seen and its mean, minimum and maximum
+# instruction count.
+
+import argparse
+import json
+import re
+import socket
+import subprocess
+import sys
+import tempfile
+import time
+from pathlib import Path
+
+sys.path.insert(0, str(Path(__file__).resolve().parent.parent / "sim"))
+from soak import TRAILER_RE, BoardOutput, BoardTimeout, enable_features  # noqa: E402
+
+TRACE_RE = re.compile(rb"([tr])([0-9a-f]{2}) ([0-9a-f]{16})\n")
+
+# Board link magics, see board_link.h
+MAGIC_NAMES = {
+    0x53: "HANDSHAKE",
+    0x54: "ACK",
+    0x55: "PAIR",
+    0x56: "UNLOCK",
+    0x57: "START",
+    0x58: "LINK_ACK",
+}
+HANDSHAKE_MAGIC = 0x53
+
+# The lm3s6965evb's system clock in QEMU, QEMU_CLOCK_HZ in qemu_hal.c
+CLOCK_HZ = 200000000
+
+
+# @brief Connect to a unix socket served by QEMU, waiting for it to appear
+def connect(path, timeout):
+    deadline = time.monotonic() + timeout
+    while True:
+        sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        try:
+            sock.connect(str(path))
+            return sock
+        except (FileNotFoundError, ConnectionRefusedError):
+            sock.close()
+            if time.monotonic() > deadline:
+                raise
+            time.sleep(0.05)
+
+
+# @brief An emulated board: its QEMU process, host UART and trace UART
+class EmulatedBoard:
+    def __init__(self, args, image, tmp, name, link):
+        host_path = tmp / f"{name}_host.sock"
+        trace_path = tmp / f"{name}_trace.sock"
+
+        self.process = subprocess.Popen(
+            [
+                args.qemu,
+                "-M", "lm3s6965evb",
+                "-cpu", args.cpu,
+                "-nographic",
+                "-monitor", "none",
+                "-icount", "shift=0,align=off,sleep=off",
+                "-kernel", str(image),
+                "-serial", f"unix:{host_path},server=on,wait=off",
+                "-serial", link,
+                "-serial", f"unix:{trace_path},server=on,wait=off",
+            ],
+            stdin=subprocess.DEVNULL,
+        )
+
+        self.host = connect(host_path, args.timeout)
+        self.trace = connect(trace_path, args.timeout)
+        self.out = BoardOutput(self.host.makefile("rb"))
+        self.trace_out = BoardOutput(self.trace.makefile("rb"))
+
+    # @brief Take every complete trace record received so far
+    # @return list of (direction, magic, ticks)
+    def take_trace(self):
+        with self.trace_out.cond:
+            records = TRACE_RE.findall(self.trace_out.buffer)
+            end = self.trace_out.buffer.rfind(b"\n") + 1
+            del self.trace_out.buffer[:end]
+        return [(d.decode(), int(m, 16), int(t, 16)) for d, m, t in records]
+
+    def close(self):
+        self.process.kill()
+        self.process.wait()
+        self.host.close()
+        self.trace.close()
+
+
+# @brief A car and paired fob connected by their board link
+class EmulatedPair:
+    def __init__(self, args):
+        self.tmp = tempfile.TemporaryDirectory(prefix="qemu_unlock_")
+        tmp = Path(self.tmp.name)
+        link = tmp / "link.sock"
+
+        self.car = EmulatedBoard(
+            args, args.build_dir / "car.axf", tmp, "car",
+            f"unix:{link},server=on,wait=off",
+        )
+        # The car's board link socket is listening once its trace socket is,
+        # and the fob connects to it
+        self.fob = EmulatedBoard(
+            args, args.build_dir / "fob.axf", tmp, "fob", f"unix:{link}"
+        )
+
+        # Interface used by soak.enable_features
+        self.car_out = self.car.out
+        self.fob_out = self.fob.out
+
+    # @brief Press SW1 on the fob
+    def press_button(self):
+        self.fob.trace.sendall(b"\x01")
+
+    # @brief Send a host command to the fob
+    def fob_command(self, data):
+        self.fob.host.sendall(data)
+
+    def close(self):
+        self.fob.close()
+        self.car.close()
+        self.tmp.cleanup()
+
+
+# @brief Name a frame event
+def event_name(direction, magic):
+    return f"{'tx' if direction == 't' else 'rx'} {MAGIC_NAMES.get(magic, hex(magic))}"
+
+
+# @brief Add the instructions between a board's frame events to the totals
+def count_transitions(board, trace, transitions):
+    for (d0, m0, t0), (d1, m1, t1) in zip(trace, trace[1:]):
+        if d1 != "t" or (board == "fob" and m1 == HANDSHAKE_MAGIC):
+            continue
+
+        instructions = (t1 - t0) * 1000000000 // CLOCK_HZ
+        key = f"{board}: {event_name(d0, m0)} -> {event_name(d1, m1)}"
+        entry = transitions.setdefault(
+            key, {"count": 0, "total": 0, "min": instructions, "max": instructions}
+        )
+        entry["count"] += 1
+        entry["total"] += instructions
+        entry["min"] = min(entry["min"], instructions)
+        entry["max"] = max(entry["max"], instructions)
+
+
+# @brief Run the unlock cycles
+# @return results dictionary
+def run(args):
+    pair = EmulatedPair(args)
+    traces = {"car": [], "fob": []}
+    completed = 0
+    timeouts = 0
+
+    try:
+        enable_features(
+            pair, args.sim_build_dir, args.car_id, args.features, args.timeout
+        )
+        pair.car_out.clear()
+
+        for _ in range(args.cycles):
+            pair.press_button()
+            try:
+                pair.car_out.expect(TRAILER_RE, args.timeout)
+                completed += 1
+            except BoardTimeout:
+                timeouts += 1
+
+        # Let the last link acks reach the trace
+        time.sleep(0.5)
+        traces["car"] = pair.car.take_trace()
+        traces["fob"] = pair.fob.take_trace()
+    finally:
+        pair.close()
+
+    transitions = {}
+    for board, trace in traces.items():
+        count_transitions(board, trace, transitions)
+
+    return {
+        "cycles": args.cycles,
+        "completed": completed,
+        "timeouts": timeouts,
+        "features": args.features,
+        "instructions": {
+            key: {
+                "count": entry["count"],
+                "mean": entry["total"] // entry["count"],
+                "min": entry["min"],
+                "max": entry["max"],
+            }
+            for key, entry in sorted(transitions.items())
+        },
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument(
+        "--build-dir", help="qemu/Makefile build directory", type=Path, default="build",
+    )
+    parser.add_argument(
+        "--sim-build-dir",
+        help="sim/Makefile build directory, for the deployment secrets",
+        type=Path,
+        default="../sim/build",
+    )
+    parser.add_argument(
+        "--car-id", help="Car ID the images were built with", type=int, default=1,
+    )
+    parser.add_argument("--cycles", help="Unlock cycles to run", type=int, default=20)
+    parser.add_argument(
+        "--features", help="Features to enable before the run", type=int, default=3,
+    )
+    parser.add_argument(
+        "--timeout", help="Seconds to wait for each cycle", type=float, default=60,
+    )
+    parser.add_argument("--qemu", help="QEMU binary", default="qemu-system-arm")
+    parser.add_argument("--cpu", help="QEMU CPU model", default="cortex-m3")
+    parser.add_argument("--results", help="JSON results output file", type=Path)
+    args = parser.parse_args()
+
+    results = run(args)
+
+    output = json.dumps(results, indent=2)
+    if args.results:
+        args.results.parent.mkdir(parents=True, exist_ok=True)
+        args.results.write_text(output + "\n")
+
+    print(f"{results['completed']}/{results['cycles']} unlocks completed")
+    print(f"{'transition':<48} {'count':>6} {'mean':>12} {'min':>12} {'max':>12}")
+    for key, entry in results["instructions"].items():
+        print(
+            f"{key:<48} {entry['count']:>6} {entry['mean']:>12} "
+            f"{entry['min']:>12} {entry['max']:>12}"
+        )
+
+    return 0 if results["timeouts"] == 0 else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
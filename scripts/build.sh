@@ -9,6 +9,9 @@ python3 -m ectf_tools build.tools --design . --name exp_design
 # Build Deployment
 python3 -m ectf_tools build.depl --design . --name exp_design --deployment exp_deployment
 
+# Copy the code shared by the car and the fob into each board's directory
+make -C common vendor
+
 # Build Car and Paired Fob
 python3 -m ectf_tools build.car_fob_pair --design . --name exp_design --deployment exp_deployment --car-out ./outputs/test_car --fob-out ./outputs/test_paired_fob --car-name car --fob-name paired_fob --car-id 1000 --pair-pin 001234 --car-feature1-secret "FEATURE 1 SECRET" --car-feature2-secret "FEATURE 2WO SECRET" --car-feature3-secret "FEATURE THREE SECRET"
 
@@ -0,0 +1,5 @@
+#!/usr/bin/env bash
+
+# Same bridge ports as run_bridges_boards_1_2.sh, served by the local bridge
+make -C bridge
+./bridge/bridge 2000=serial:/dev/board1 2001=serial:/dev/board2
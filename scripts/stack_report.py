@@ -0,0 +1,154 @@
+#!/usr/bin/python3 -u
+
+# @file stack_report.py
+# @brief Worst-case stack usage report for car and fob firmware
+# @date 2023
+#
+# Combines the per-function stack usage and call graph emitted by GCC's
+# -fcallgraph-info=su (.ci files) into the worst-case stack depth reachable
+# from each entry point. Functions without call graph information (e.g.
+# prebuilt driverlib, libc and libgcc routines) are counted as 0 bytes and
+# listed so the report never silently claims more precision than it has.
+
+import argparse
+import re
+import sys
+from pathlib import Path
+
+NODE_RE = re.compile(r'node: \{ title: "([^"]+)" label: "([^"]*)"')
+EDGE_RE = re.compile(r'edge: \{ sourcename: "([^"]+)" targetname: "([^"]+)"')
+STACK_RE = re.compile(r"\\n(\d+) bytes \((\w+(?:,\w+)*)\)")
+STACK_SIZE_RE = re.compile(r"_STACK_SIZE\s*=\s*(0x[0-9a-fA-F]+|\d+)\s*;")
+
+INDIRECT_CALL = "__indirect_call"
+
+
+# @brief Parse a set of .ci files into a stack usage table and call graph
+# @param ci_files, list of paths to .ci files
+# @return (frames, qualifiers, calls) dictionaries keyed by function name
+def parse_call_graph(ci_files):
+    frames = {}
+    qualifiers = {}
+    calls = {}
+
+    for ci_file in ci_files:
+        with open(ci_file, "r") as f:
+            for line in f:
+                node = NODE_RE.search(line)
+                if node:
+                    name, label = node.groups()
+                    stack = STACK_RE.search(label)
+                    if stack:
+                        frames[name] = int(stack.group(1))
+                        qualifiers[name] = stack.group(2)
+                    continue
+
+                edge = EDGE_RE.search(line)
+                if edge:
+                    source, target = edge.groups()
+                    calls.setdefault(source, set()).add(target)
+
+    return frames, qualifiers, calls
+
+
+# @brief Compute the worst-case stack depth reachable from a function
+# @param name, function to start from
+# @param frames, per-function frame sizes
+# @param calls, call graph
+# @param notes, dictionary collecting unknown/recursive/indirect functions
+# @return (depth, path) for the deepest call chain
+def worst_case(name, frames, calls, notes, active=None, memo=None):
+    active = set() if active is None else active
+    memo = {} if memo is None else memo
+
+    if name in memo:
+        return memo[name]
+
+    if name in active:
+        notes.setdefault("recursive", set()).add(name)
+        return 0, [name + " (recursion)"]
+
+    if name == INDIRECT_CALL:
+        notes.setdefault("indirect", set()).add(name)
+        return 0, ["<indirect call>"]
+
+    if name not in frames:
+        notes.setdefault("unknown", set()).add(name)
+
+    active.add(name)
+    deepest, deepest_path = 0, []
+    for callee in sorted(calls.get(name, ())):
+        depth, path = worst_case(callee, frames, calls, notes, active, memo)
+        if depth > deepest or not deepest_path:
+            deepest, deepest_path = depth, path
+    active.remove(name)
+
+    result = (frames.get(name, 0) + deepest, [name] + deepest_path)
+    memo[name] = result
+    return result
+
+
+# @brief Read the stack reservation from a linker script
+# @param linker_script, path to the linker script
+# @return stack size in bytes, or None if not found
+def read_stack_size(linker_script):
+    match = STACK_SIZE_RE.search(Path(linker_script).read_text())
+    if match is None:
+        return None
+    return int(match.group(1), 0)
+
+
+# @brief Main function
+#
+# Main function handles parsing arguments and printing the report. Exits
+# non-zero if any entry point can exceed the reserved stack.
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument(
+        "ci_files", help="Call graph files produced by -fcallgraph-info=su", nargs="+",
+    )
+    parser.add_argument(
+        "--entry",
+        help="Entry point to report on (may be repeated)",
+        action="append",
+        default=None,
+    )
+    parser.add_argument(
+        "--linker-script", help="Linker script defining _STACK_SIZE", type=Path,
+    )
+    args = parser.parse_args()
+
+    entries = args.entry or ["Firmware_Startup"]
+    frames, qualifiers, calls = parse_call_graph(args.ci_files)
+    stack_size = read_stack_size(args.linker_script) if args.linker_script else None
+
+    exceeded = False
+    notes = {}
+    for entry in entries:
+        depth, path = worst_case(entry, frames, calls, notes)
+        print(f"{entry}: {depth} bytes worst case")
+        for function in path:
+            qualifier = qualifiers.get(function)
+            size = frames.get(function)
+            if size is None:
+                print(f"    {function}")
+            else:
+                print(f"    {function}: {size} ({qualifier})")
+
+        if stack_size is not None:
+            print(f"    headroom: {stack_size - depth} of {stack_size} bytes")
+            exceeded |= depth > stack_size
+
+    dynamic = sorted(f for f, q in qualifiers.items() if "dynamic" in q)
+    if dynamic:
+        print("Functions with dynamic stack usage: " + ", ".join(dynamic))
+    for kind in ("recursive", "indirect", "unknown"):
+        if notes.get(kind):
+            print(f"Unaccounted ({kind}): " + ", ".join(sorted(notes[kind])))
+
+    if exceeded:
+        sys.exit("ERROR: worst-case stack usage exceeds the reserved stack")
+
+
+if __name__ == "__main__":
+    main()
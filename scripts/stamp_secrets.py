@@ -0,0 +1,178 @@
+#!/usr/bin/python3 -u
+
+# @file stamp_secrets.py
+# @brief Provision car and fob template images with per-device secrets
+# @date 2023
+#
+# A template image is built once with `make car_template` or
+# `make fob_template`. Its .secrets section (see firmware.ld and
+# secrets_section.h) sits at a fixed offset and holds placeholders. This tool
+# patches the car ID, pair PIN, derived board link key and signing public key
+# into copies of the template's .bin and .axf, and recomputes the section
+# checksum. No compilation or linking is needed.
+#
+# Output paths may contain "{car_id}" to stamp images for many cars in one run.
+
+import argparse
+import struct
+import subprocess
+import sys
+import time
+import zlib
+from pathlib import Path
+
+# Keep in sync with firmware.ld and secrets_section.h
+SECRETS_OFFSET = 0x400
+SECRETS_MAGIC = 0x53435254
+SECRETS_VERSION = 1
+SECRETS_FORMAT = "<IIII8s32s32s"
+
+SHT_PROGBITS = 1
+SHT_SYMTAB = 2
+
+
+# @brief Parse a "0xXX,0xXX," byte list as written by the deployment tools
+def parse_c_bytes(text):
+    return bytes(int(b, 16) for b in text.strip().split(",") if b.strip())
+
+
+# @brief Pack the secrets section, including its CRC-32 checksum
+def pack_secrets(car_id, paired, pair_pin, message_key, signing_public_key):
+    packed = struct.pack(
+        SECRETS_FORMAT,
+        SECRETS_MAGIC,
+        SECRETS_VERSION,
+        car_id,
+        paired,
+        pair_pin.encode().ljust(8, b"\0"),
+        message_key,
+        signing_public_key,
+    )
+    return packed + struct.pack("<I", zlib.crc32(packed))
+
+
+# @brief Find the file offset of a symbol in a 32-bit ELF image
+#
+# The .secrets input section is merged into the .text output section, so it is
+# located through the _secrets symbol defined by firmware.ld.
+#
+# @param elf, contents of the ELF file
+# @param name, symbol name
+# @return file offset of the symbol's address
+def find_elf_symbol(elf, name):
+    if elf[:4] != b"\x7fELF" or elf[4] != 1 or elf[5] != 1:
+        raise ValueError("not a 32-bit little-endian ELF file")
+
+    (e_shoff,) = struct.unpack_from("<I", elf, 0x20)
+    e_shentsize, e_shnum = struct.unpack_from("<HH", elf, 0x2E)
+
+    # (name, type, flags, addr, offset, size, link)
+    sections = [
+        struct.unpack_from("<IIIIIII", elf, e_shoff + i * e_shentsize)
+        for i in range(e_shnum)
+    ]
+
+    address = None
+    for _, sh_type, _, _, sh_offset, sh_size, sh_link in sections:
+        if sh_type != SHT_SYMTAB:
+            continue
+        strtab_offset = sections[sh_link][4]
+        for sym in range(sh_offset, sh_offset + sh_size, 16):
+            st_name, st_value = struct.unpack_from("<II", elf, sym)
+            end = elf.index(b"\0", strtab_offset + st_name)
+            if elf[strtab_offset + st_name : end] == name:
+                address = st_value
+
+    if address is None:
+        raise ValueError(f"no {name.decode()} symbol")
+
+    for _, sh_type, _, sh_addr, sh_offset, sh_size, _ in sections:
+        if sh_type == SHT_PROGBITS and sh_addr <= address < sh_addr + sh_size:
+            return sh_offset + address - sh_addr
+
+    raise ValueError(f"{name.decode()} is not in a loaded section")
+
+
+# @brief Check that an image region holds a secrets section
+def check_template(image, offset, source):
+    magic, version = struct.unpack_from("<II", image, offset)
+    if magic != SECRETS_MAGIC or version != SECRETS_VERSION:
+        sys.exit(f"ERROR: {source} has no version {SECRETS_VERSION} secrets section")
+
+
+# @brief Write a copy of an image with the secrets section replaced
+def stamp(image, offset, secrets, output):
+    stamped = bytearray(image)
+    stamped[offset : offset + len(secrets)] = secrets
+    Path(output).write_bytes(stamped)
+
+
+# @brief Main function
+#
+# Main function handles parsing arguments and stamping one image per car ID.
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--template-bin", type=Path, required=True)
+    parser.add_argument("--template-elf", type=Path)
+    parser.add_argument("--bin-out", type=str, required=True)
+    parser.add_argument("--elf-out", type=str)
+    parser.add_argument("--car-id", type=int, nargs="+", default=[0])
+    parser.add_argument("--pair-pin", type=str, default="000000")
+    parser.add_argument(
+        "--paired",
+        help="Stamp a paired fob (cars and unpaired fobs leave this unset)",
+        action="store_true",
+    )
+    parser.add_argument(
+        "--unpaired-fob",
+        help="Stamp an unpaired fob, which gets no board link key",
+        action="store_true",
+    )
+    parser.add_argument("--master-key-file", type=Path)
+    parser.add_argument("--derive-key-tool", type=Path, default="/tmp/derive_key")
+    parser.add_argument("--signing-public-key-file", type=Path, required=True)
+    args = parser.parse_args()
+
+    start = time.perf_counter()
+
+    template_bin = args.template_bin.read_bytes()
+    check_template(template_bin, SECRETS_OFFSET, args.template_bin)
+
+    if args.template_elf:
+        template_elf = args.template_elf.read_bytes()
+        elf_offset = find_elf_symbol(template_elf, b"_secrets")
+        check_template(template_elf, elf_offset, args.template_elf)
+
+    signing_public_key = parse_c_bytes(args.signing_public_key_file.read_text())
+
+    for car_id in args.car_id:
+        # Derive this car's link key from the deployment master key
+        if args.unpaired_fob:
+            message_key = bytes(32)
+        else:
+            message_key = parse_c_bytes(
+                subprocess.run(
+                    [args.derive_key_tool, args.master_key_file, str(car_id)],
+                    check=True,
+                    capture_output=True,
+                    text=True,
+                ).stdout
+            )
+
+        secrets = pack_secrets(
+            car_id, int(args.paired), args.pair_pin, message_key, signing_public_key
+        )
+
+        stamp(template_bin, SECRETS_OFFSET, secrets, args.bin_out.format(car_id=car_id))
+        if args.template_elf and args.elf_out:
+            stamp(template_elf, elf_offset, secrets, args.elf_out.format(car_id=car_id))
+
+    elapsed = time.perf_counter() - start
+    print(
+        f"Stamped {len(args.car_id)} image(s) in {elapsed * 1000:.1f} ms "
+        f"({elapsed * 1000 / len(args.car_id):.2f} ms/image)"
+    )
+
+
+if __name__ == "__main__":
+    main()
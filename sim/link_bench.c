@@ -0,0 +1,817 @@
+/**
+ * @file link_bench.c
+ * @brief Host benchmark of board link junk filtering and error recovery
+ * @date 2023
+ *
+ * Links the car's board_link.c against an in-memory board UART.
+ *
+ * The junk benchmark feeds receive_board_message_by_type() a stream of junk
+ * frames of one kind, followed by the UNLOCK frame it is waiting for:
+ *
+ *  - noise: random bytes, rejected as malformed frames or by their CRC
+ *  - bad-length: UNLOCK frames with a valid CRC but a length outside the
+ *    UNLOCK bounds
+ *  - unexpected: valid HANDSHAKE frames, skipped without being decrypted
+ *  - bad-mac: UNLOCK frames under another key, which still have to be
+ *    decrypted
+ *
+ * Before header checks and per-state filtering, every frame was decrypted, so
+ * the bad-mac cost is also what any junk frame used to cost.
+ *
+ * The oversize check sends the START receiver, and the PAIR receiver of the
+ * second copy below, frames longer and shorter than FEATURE_DATA and
+ * PAIR_PACKET, and checks that each is counted as bad_length and that none is
+ * copied past the message structure.
+ *
+ * The recovery benchmark flips random bits in a stream of numbered UNLOCK
+ * frames at several bit error rates and receives it with
+ * receive_board_message(). For every corrupted byte it reports how long the
+ * link takes to deliver a frame again, at the board link's 115200 baud, and
+ * checks that no corrupted frame is ever accepted.
+ *
+ * The mode benchmark compares LINK_MODE_ARQ against LINK_MODE_FEC. It runs a
+ * second copy of board_link.c as the other board, and sends it messages with
+ * send_board_message() over a simulated 115200 baud line that flips bits in
+ * both directions. Time is simulated too, so goodput and latency are what the
+ * line allows, without the host's CPU time.
+ *
+ * The frame cost benchmark times the host CPU work per message for the
+ * UNLOCK and START messages: encryption and decryption alone, and a message
+ * sent, received and acked over a clean simulated line.
+ *
+ * The restart check sets up the near board's link again, as after a reset or
+ * a resume, before each of many handshake requests to the second copy, which
+ * keeps its link state. Between restarts it is sent from 1 to 255 messages,
+ * so that it holds every sequence number in turn, and it must take every
+ * request.
+ */
+
+#define _GNU_SOURCE
+
+#include <math.h>
+#include <setjmp.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "inc/hw_memmap.h"
+
+#include "driverlib/gpio.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/timer.h"
+#include "driverlib/uart.h"
+
+#include "board_link.h"
+#include "hydrogen.h"
+#include "uart.h"
+
+#define BENCH_FRAMES 20000
+#define BENCH_FRAME_LEN (2 * FRAME_MAX_LENGTH)
+#define BENCH_STREAM_LEN (BENCH_FRAMES * (FRAME_OVERHEAD + 48))
+
+// Seconds per byte on the board link, 115200 baud 8-N-1
+#define BENCH_BYTE_TIME (10.0 / 115200)
+
+static uint8_t key[hydro_secretbox_KEYBYTES];
+static uint8_t other_key[hydro_secretbox_KEYBYTES];
+uint8_t *message_key = key;
+
+// Board UART receive stream and capture of the first frame transmitted, the
+// host UART and everything after that frame are dropped. While a frame is
+// being captured the receive stream looks empty, so nothing acks it.
+static uint8_t rx[BENCH_STREAM_LEN];
+static uint32_t rx_len, rx_off;
+static uint8_t tx[BENCH_FRAME_LEN];
+static uint32_t tx_len;
+static bool capturing;
+
+// Host UART output, kept while a board link report is read
+static char report[4096];
+static uint32_t report_len;
+static bool reporting;
+
+// Timer 0, which jumps ahead by seconds every time it is read so that link
+// acks for the frames built with send_board_message() time out at once
+static uint32_t timer_value;
+
+// Where UARTCharGet() returns to when the stream runs out, if set
+static jmp_buf *end_of_stream;
+
+// The other board, a second copy of board_link.c with its own link state
+void peer_setup_board_link(uint8_t mode);
+uint32_t peer_receive_board_message(MESSAGE_PACKET *message);
+uint32_t peer_receive_board_message_by_type(MESSAGE_PACKET *message,
+                                            uint8_t type);
+void peer_board_link_report(void);
+
+#define MODE_BENCH_MESSAGES 2000
+
+// System clock ticks per byte on the board link
+#define BYTE_TICKS (uint64_t)(BENCH_BYTE_TIME * 80000000)
+
+// One end of the simulated line: bytes received and not yet read, and bytes
+// sent since the line last carried them over
+typedef struct {
+  uint8_t rx[BENCH_FRAME_LEN];
+  uint32_t rx_len, rx_off;
+  uint8_t tx[BENCH_FRAME_LEN];
+  uint32_t tx_len;
+} LINE_END;
+
+// While simulating, the board UART and timer 0 belong to the simulated line
+// and clock instead of the streams above
+static bool simulating;
+static LINE_END ends[2];
+static LINE_END *active = &ends[0];
+static uint64_t sim_ticks;
+static double line_bit_error_rate;
+
+// Messages the other board has taken, the message the near board is sending,
+// and frames carried from the near board
+static bool peer_delivered[MODE_BENCH_MESSAGES];
+static uint32_t peer_current;
+static uint32_t peer_bad_numbers;
+static uint32_t peer_requests;
+static uint32_t line_frames;
+
+void SysCtlPeripheralEnable(uint32_t ui32Peripheral) {}
+
+uint32_t SysCtlClockGet(void) { return 80000000; }
+
+void GPIOPinConfigure(uint32_t ui32PinConfig) {}
+
+void GPIOPinTypeUART(uint32_t ui32Port, uint8_t ui8Pins) {}
+
+void UARTConfigSetExpClk(uint32_t ui32Base, uint32_t ui32UARTClk,
+                         uint32_t ui32Baud, uint32_t ui32Config) {}
+
+static void carry_frames(void);
+
+bool UARTCharsAvail(uint32_t ui32Base) {
+  if (simulating) {
+    // Only the near board polls, while waiting for a link ack
+    if (ends[0].tx_len) {
+      carry_frames();
+    }
+    if (ends[0].rx_off < ends[0].rx_len) {
+      return true;
+    }
+    sim_ticks += BYTE_TICKS;
+    return false;
+  }
+  return ui32Base == BOARD_UART && rx_off < rx_len && !capturing;
+}
+
+int32_t UARTCharGet(uint32_t ui32Base) {
+  if (simulating && active->rx_off == active->rx_len) {
+    longjmp(*end_of_stream, 1);
+  }
+  if (simulating) {
+    return active->rx[active->rx_off++];
+  }
+  if (ui32Base == BOARD_UART && rx_off == rx_len && end_of_stream) {
+    longjmp(*end_of_stream, 1);
+  }
+  if (ui32Base != BOARD_UART || rx_off == rx_len) {
+    fprintf(stderr, "link_bench: read past the end of the stream\n");
+    exit(1);
+  }
+  return rx[rx_off++];
+}
+
+void UARTCharPut(uint32_t ui32Base, unsigned char ucData) {
+  if (simulating) {
+    if (ui32Base == BOARD_UART && active->tx_len < BENCH_FRAME_LEN) {
+      active->tx[active->tx_len++] = ucData;
+      sim_ticks += BYTE_TICKS;
+    }
+    return;
+  }
+
+  if (ui32Base == HOST_UART && reporting && report_len < sizeof(report) - 1) {
+    report[report_len++] = ucData;
+  }
+
+  bool captured = tx_len > 1 && tx[tx_len - 1] == FRAME_DELIMITER;
+
+  if (ui32Base == BOARD_UART && capturing && !captured &&
+      tx_len < sizeof(tx)) {
+    tx[tx_len++] = ucData;
+  }
+}
+
+void TimerConfigure(uint32_t ui32Base, uint32_t ui32Config) {}
+
+void TimerLoadSet(uint32_t ui32Base, uint32_t ui32Timer, uint32_t ui32Value) {}
+
+void TimerEnable(uint32_t ui32Base, uint32_t ui32Timer) {}
+
+uint32_t TimerValueGet(uint32_t ui32Base, uint32_t ui32Timer) {
+  if (simulating) {
+    return 0xFFFFFFFF - (uint32_t)sim_ticks;
+  }
+  timer_value -= 0x10000000;
+  return timer_value;
+}
+
+/**
+ * @brief Flip random bits at a bit error rate
+ *
+ * @param buffer the bytes to corrupt
+ * @param length the number of bytes
+ * @param bit_error_rate probability that any one bit is flipped
+ */
+static void flip_bits(uint8_t *buffer, uint32_t length, double bit_error_rate) {
+  double bits = 0;
+
+  // Use the gaps between errors, which are exponentially distributed
+  while (bit_error_rate > 0) {
+    double uniform = (hydro_random_u32() + 1.0) / 4294967297.0;
+    bits += -log(uniform) / bit_error_rate;
+    if (bits >= length * 8.0) {
+      break;
+    }
+    uint32_t bit = (uint32_t)bits;
+    buffer[bit / 8] ^= 1 << (bit % 8);
+  }
+}
+
+/**
+ * @brief Carry bytes over the simulated line, corrupting them on the way
+ *
+ * @param from the sending end
+ * @param to the receiving end
+ */
+static void carry_bytes(LINE_END *from, LINE_END *to) {
+  flip_bits(from->tx, from->tx_len, line_bit_error_rate);
+
+  // Bytes already read are gone, unread ones stay ahead of the new ones
+  memmove(to->rx, &to->rx[to->rx_off], to->rx_len - to->rx_off);
+  to->rx_len -= to->rx_off;
+  to->rx_off = 0;
+  if (to->rx_len + from->tx_len > BENCH_FRAME_LEN) {
+    to->rx_len = 0;
+  }
+  memcpy(&to->rx[to->rx_len], from->tx, from->tx_len);
+  to->rx_len += from->tx_len;
+  from->tx_len = 0;
+}
+
+/**
+ * @brief Let the other board receive everything on its end of the line
+ *
+ * It runs until it tries to read past the last byte, and keeps track of the
+ * numbered messages it takes.
+ */
+static void run_peer(void) {
+  static uint8_t buffer[MESSAGE_MAX_LENGTH];
+  static MESSAGE_PACKET message = {0, 0, buffer};
+  jmp_buf done;
+
+  active = &ends[1];
+  end_of_stream = &done;
+  if (!setjmp(done)) {
+    while (true) {
+      // A handshake request is empty, so it is told apart from a dropped
+      // frame by the magic, which is only filled in for a frame that passed
+      // the link checks
+      message.magic = 0;
+      int32_t received = peer_receive_board_message(&message);
+      if (received == 0 && message.magic == HANDSHAKE_MAGIC) {
+        peer_requests++;
+      }
+      if (received <= 0) {
+        continue;
+      }
+
+      uint32_t number;
+      memcpy(&number, buffer, sizeof(number));
+      if (number != peer_current || peer_delivered[number]) {
+        peer_bad_numbers++;
+      } else {
+        peer_delivered[number] = true;
+      }
+    }
+  }
+  end_of_stream = NULL;
+  active = &ends[0];
+}
+
+/**
+ * @brief Carry the near board's frames to the other board, and its link acks
+ * back
+ */
+static void carry_frames(void) {
+  line_frames++;
+  carry_bytes(&ends[0], &ends[1]);
+  run_peer();
+  carry_bytes(&ends[1], &ends[0]);
+}
+
+/**
+ * @brief Frame a message with the real sender and append it to the stream
+ *
+ * @param magic the message type
+ * @param length the plaintext length
+ * @param plaintext the plaintext, or NULL for zeros
+ * @return uint32_t the stream offset of the frame
+ */
+static uint32_t append_frame(uint8_t magic, uint8_t length,
+                             const uint8_t *plaintext) {
+  uint8_t buffer[MESSAGE_MAX_LENGTH] = {0};
+  MESSAGE_PACKET message = {magic, length, buffer};
+  uint32_t offset = rx_len;
+
+  if (plaintext) {
+    memcpy(buffer, plaintext, length);
+  }
+
+  tx_len = 0;
+  capturing = true;
+  send_board_message(&message);
+  capturing = false;
+  if (rx_len + tx_len > sizeof(rx)) {
+    fprintf(stderr, "link_bench: stream too long\n");
+    exit(1);
+  }
+  memcpy(&rx[rx_len], tx, tx_len);
+  rx_len += tx_len;
+  return offset;
+}
+
+/**
+ * @brief Fill the receive stream with junk frames and a final UNLOCK frame
+ *
+ * @param kind the junk frame kind
+ * @param frames the number of junk frames
+ */
+static void build_junk_stream(const char *kind, uint32_t frames) {
+  rx_len = 0;
+  rx_off = 0;
+
+  for (uint32_t i = 0; i < frames; i++) {
+    if (!strcmp(kind, "noise")) {
+      hydro_random_buf(&rx[rx_len], FRAME_OVERHEAD + 40);
+      rx_len += FRAME_OVERHEAD + 40;
+    } else if (!strcmp(kind, "bad-length")) {
+      append_frame(UNLOCK_MAGIC, 3, NULL);
+    } else if (!strcmp(kind, "unexpected")) {
+      append_frame(HANDSHAKE_MAGIC, 4, NULL);
+    } else {
+      message_key = other_key;
+      append_frame(UNLOCK_MAGIC, 4, NULL);
+      message_key = key;
+    }
+  }
+
+  append_frame(UNLOCK_MAGIC, 4, NULL);
+}
+
+/**
+ * @brief Read one counter of a receive state from a board link report
+ *
+ * @param link_report board_link_report of the board to read
+ * @param magic the awaited message type
+ * @param counter the counter's name in the report
+ * @return uint32_t the counter, 0 if the state has seen no frames
+ */
+static uint32_t link_counter(void (*link_report)(void), uint8_t magic,
+                             const char *counter) {
+  char state[32];
+  unsigned int value = 0;
+
+  report_len = 0;
+  reporting = true;
+  link_report();
+  reporting = false;
+  report[report_len] = 0;
+
+  snprintf(state, sizeof(state), "\r\nLink 0x%08x:", magic);
+  char *line = strstr(report, state);
+  if (line) {
+    char *found = strstr(line, counter);
+    sscanf(found + strlen(counter), " %x", &value);
+  }
+  return value;
+}
+
+/**
+ * @brief Check that frames of the wrong length never reach a message buffer
+ *
+ * Sends the receiver of one message type a frame of the longest length, one
+ * a byte too long and one a byte too short, then one of the right length.
+ * The car's copy of the board link has no PAIR receiver, so PAIR frames go to
+ * the second copy, which accepts every message type.
+ *
+ * @param magic the message type
+ * @param length its plaintext length
+ */
+static void check_oversize(uint8_t magic, uint8_t length) {
+  bool peer = magic == PAIR_MAGIC;
+  void (*link_report)(void) = peer ? peer_board_link_report : board_link_report;
+  const uint8_t lengths[] = {MESSAGE_MAX_LENGTH, length + 1, length - 1,
+                             length};
+  uint8_t plaintext[MESSAGE_MAX_LENGTH];
+  uint8_t buffer[2 * MESSAGE_MAX_LENGTH] = {0};
+  MESSAGE_PACKET message = {0, 0, buffer};
+  uint32_t before = link_counter(link_report, magic, "bad_length");
+
+  memset(plaintext, 0xA5, sizeof(plaintext));
+  rx_len = 0;
+  rx_off = 0;
+  for (uint32_t i = 0; i < sizeof(lengths); i++) {
+    append_frame(magic, lengths[i], plaintext);
+  }
+
+  if (peer) {
+    peer_receive_board_message_by_type(&message, magic);
+  } else {
+    receive_board_message_by_type(&message, magic);
+  }
+  uint32_t dropped = link_counter(link_report, magic, "bad_length") - before;
+
+  bool overrun = false;
+  for (uint32_t i = length; i < sizeof(buffer); i++) {
+    overrun |= buffer[i] != 0;
+  }
+
+  printf("%-8s %8u %8u %8s\n", magic == PAIR_MAGIC ? "pair" : "start", length,
+         dropped, overrun ? "yes" : "no");
+
+  if (message.message_len != length || rx_off != rx_len ||
+      dropped != sizeof(lengths) - 1 || overrun) {
+    fprintf(stderr, "link_bench: wrong length frames were not dropped\n");
+    exit(1);
+  }
+}
+
+/**
+ * @brief Time how long the UNLOCK receiver takes to get through junk frames
+ *
+ * @param kind the junk frame kind
+ * @return double nanoseconds per junk frame
+ */
+static double bench_junk(const char *kind) {
+  uint8_t buffer[MESSAGE_MAX_LENGTH];
+  MESSAGE_PACKET message = {0, 0, buffer};
+  struct timespec start, end;
+
+  build_junk_stream(kind, BENCH_FRAMES - 1);
+
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+  receive_board_message_by_type(&message, UNLOCK_MAGIC);
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+
+  if (message.magic != UNLOCK_MAGIC || rx_off != rx_len) {
+    fprintf(stderr, "link_bench: %s stream did not end in its UNLOCK frame\n",
+            kind);
+    exit(1);
+  }
+
+  return ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) /
+         (BENCH_FRAMES - 1);
+}
+
+/**
+ * @brief Receive UNLOCK frames numbered by their plaintext until the stream
+ * runs out
+ *
+ * @param delivered set for every frame number received
+ * @param num_frames the number of frames sent
+ * @return uint32_t the number of out of range or repeated frame numbers
+ */
+static uint32_t receive_numbered_frames(bool *delivered, uint32_t num_frames) {
+  static uint32_t bad_numbers;
+  uint8_t buffer[MESSAGE_MAX_LENGTH];
+  MESSAGE_PACKET message = {0, 0, buffer};
+  jmp_buf done;
+
+  memset(delivered, 0, num_frames * sizeof(bool));
+  bad_numbers = 0;
+
+  if (!setjmp(done)) {
+    end_of_stream = &done;
+    while (true) {
+      if (receive_board_message(&message) != 4 ||
+          message.magic != UNLOCK_MAGIC) {
+        continue;
+      }
+
+      uint32_t number;
+      memcpy(&number, buffer, sizeof(number));
+      if (number >= num_frames || delivered[number]) {
+        bad_numbers++;
+      } else {
+        delivered[number] = true;
+      }
+    }
+  }
+  end_of_stream = NULL;
+
+  return bad_numbers;
+}
+
+/**
+ * @brief Measure recovery from random bit errors at one bit error rate
+ *
+ * @param bit_error_rate probability that any one bit is flipped
+ */
+static void bench_recovery(double bit_error_rate) {
+  static uint32_t frame_offsets[BENCH_FRAMES + 1];
+  static bool delivered[BENCH_FRAMES];
+  static uint8_t sent[BENCH_STREAM_LEN];
+  static uint32_t errors[BENCH_STREAM_LEN];
+  uint32_t num_frames = 0, num_errors = 0, num_delivered = 0;
+
+  rx_len = 0;
+  rx_off = 0;
+  while (rx_len + FRAME_MAX_LENGTH < sizeof(rx) && num_frames < BENCH_FRAMES) {
+    uint32_t number = num_frames;
+    frame_offsets[num_frames++] = append_frame(UNLOCK_MAGIC, 4,
+                                               (uint8_t *)&number);
+  }
+  frame_offsets[num_frames] = rx_len;
+
+  memcpy(sent, rx, rx_len);
+  flip_bits(rx, rx_len, bit_error_rate);
+
+  // Flips of the same bit cancel out, so only count bytes that differ
+  for (uint32_t i = 0; i < rx_len; i++) {
+    if (rx[i] != sent[i]) {
+      errors[num_errors++] = i;
+    }
+  }
+
+  // Receive everything, noting which numbered frames make it through
+  uint32_t duplicates = receive_numbered_frames(delivered, num_frames);
+  for (uint32_t i = 0; i < num_frames; i++) {
+    num_delivered += delivered[i];
+  }
+
+  // An error inside a delivered frame means a corrupted frame got in
+  uint32_t corrupted_delivered = duplicates;
+  for (uint32_t e = 0, frame = 0; e < num_errors; e++) {
+    while (frame_offsets[frame + 1] <= errors[e]) {
+      frame++;
+    }
+    corrupted_delivered += delivered[frame];
+  }
+
+  // Recovery is from each error to the end of the next delivered frame
+  double recovery_bytes = 0, max_recovery_bytes = 0;
+  uint32_t recovered = 0;
+  uint32_t next = 0;
+  for (uint32_t e = 0; e < num_errors; e++) {
+    while (next < num_frames &&
+           (frame_offsets[next] <= errors[e] || !delivered[next])) {
+      next++;
+    }
+    if (next == num_frames) {
+      break;
+    }
+    double bytes = frame_offsets[next + 1] - errors[e];
+    recovery_bytes += bytes;
+    if (bytes > max_recovery_bytes) {
+      max_recovery_bytes = bytes;
+    }
+    recovered++;
+  }
+
+  printf("%-10.0e %9u %8u %10u %12.2f %12.2f %10u\n", bit_error_rate,
+         num_errors, num_frames - num_delivered, num_delivered,
+         recovered ? recovery_bytes / recovered * BENCH_BYTE_TIME * 1e3 : 0.0,
+         max_recovery_bytes * BENCH_BYTE_TIME * 1e3, corrupted_delivered);
+
+  if (corrupted_delivered) {
+    fprintf(stderr, "link_bench: corrupted frames were accepted\n");
+    exit(1);
+  }
+}
+
+/**
+ * @brief Set up both boards and start simulating the line between them
+ *
+ * @param mode LINK_MODE_ARQ or LINK_MODE_FEC
+ * @param bit_error_rate probability that any one bit is flipped, both ways
+ */
+static void start_line(uint8_t mode, double bit_error_rate) {
+  setup_board_link(mode);
+  peer_setup_board_link(mode);
+
+  memset(ends, 0, sizeof(ends));
+  memset(peer_delivered, 0, sizeof(peer_delivered));
+  peer_bad_numbers = 0;
+  line_frames = 0;
+  line_bit_error_rate = bit_error_rate;
+  simulating = true;
+}
+
+/**
+ * @brief Time the CPU work of one message, with and without the board link
+ *
+ * @param magic the message type
+ * @param length its plaintext length
+ */
+static void bench_frame_cost(uint8_t magic, uint8_t length) {
+  uint8_t buffer[MESSAGE_MAX_LENGTH] = {0};
+  uint8_t box[hydro_secretbox_HEADERBYTES + MESSAGE_MAX_LENGTH];
+  MESSAGE_PACKET message = {magic, length, buffer};
+  struct timespec start, end;
+  double ns[3];
+
+  // Encryption and decryption alone, as the board link calls them
+  for (uint32_t step = 0; step < 2; step++) {
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+    for (uint32_t i = 0; i < BENCH_FRAMES; i++) {
+      if (step == 0) {
+        hydro_secretbox_encrypt(box, buffer, length, 0, "boardmsg", key);
+      } else if (hydro_secretbox_decrypt(buffer, box,
+                                         hydro_secretbox_HEADERBYTES + length,
+                                         0, "boardmsg", key) != 0) {
+        fprintf(stderr, "link_bench: decryption failed\n");
+        exit(1);
+      }
+    }
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+    ns[step] =
+        ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) /
+        BENCH_FRAMES;
+  }
+
+  // A message sent, received and acked, both boards' work together
+  start_line(LINK_MODE_ARQ, 0);
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+  for (uint32_t i = 0; i < MODE_BENCH_MESSAGES; i++) {
+    peer_current = i;
+    memcpy(buffer, &i, sizeof(i));
+    send_board_message(&message);
+  }
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+  simulating = false;
+  ns[2] = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) /
+          MODE_BENCH_MESSAGES;
+
+  printf("%-6u %12.0f %12.0f %12.0f\n", length, ns[0], ns[1], ns[2]);
+}
+
+/**
+ * @brief Compare goodput and latency of the two link modes
+ *
+ * @param mode LINK_MODE_ARQ or LINK_MODE_FEC
+ * @param bit_error_rate probability that any one bit is flipped, both ways
+ * @param magic the type of every message
+ * @param length its plaintext length
+ */
+static void bench_mode(uint8_t mode, double bit_error_rate, uint8_t magic,
+                       uint8_t length) {
+  static double latencies_ms[MODE_BENCH_MESSAGES];
+  uint8_t buffer[MESSAGE_MAX_LENGTH] = {0};
+  MESSAGE_PACKET message = {magic, length, buffer};
+  uint32_t gave_up = 0, delivered = 0;
+  double total_ms = 0;
+
+  start_line(mode, bit_error_rate);
+
+  for (uint32_t i = 0; i < MODE_BENCH_MESSAGES; i++) {
+    uint64_t start = sim_ticks;
+
+    peer_current = i;
+    memcpy(buffer, &i, sizeof(i));
+    if (send_board_message(&message) == 0) {
+      gave_up++;
+    }
+
+    latencies_ms[i] = (sim_ticks - start) / 80000.0;
+    total_ms += latencies_ms[i];
+  }
+
+  simulating = false;
+  for (uint32_t i = 0; i < MODE_BENCH_MESSAGES; i++) {
+    delivered += peer_delivered[i];
+  }
+
+  // The 99th percentile, by sorting in place
+  for (uint32_t i = 1; i < MODE_BENCH_MESSAGES; i++) {
+    double latency = latencies_ms[i];
+    uint32_t j = i;
+    for (; j > 0 && latencies_ms[j - 1] > latency; j--) {
+      latencies_ms[j] = latencies_ms[j - 1];
+    }
+    latencies_ms[j] = latency;
+  }
+
+  printf("%-10.0e %-5s %6u %12.0f %10.2f %10.2f %10.3f %8u %10u\n",
+         bit_error_rate, mode == LINK_MODE_FEC ? "fec" : "arq", length,
+         delivered * length / (total_ms / 1e3), total_ms / MODE_BENCH_MESSAGES,
+         latencies_ms[MODE_BENCH_MESSAGES * 99 / 100],
+         (double)(line_frames - MODE_BENCH_MESSAGES) / MODE_BENCH_MESSAGES,
+         gave_up, peer_bad_numbers);
+
+  if (peer_bad_numbers) {
+    fprintf(stderr, "link_bench: corrupted messages were accepted\n");
+    exit(1);
+  }
+}
+
+/**
+ * @brief Check that the other board takes the handshake request of a
+ * restarted board, whatever sequence number it saw last
+ */
+static void check_restart(void) {
+  const uint32_t restarts = 1024;
+  uint8_t buffer[4] = {0};
+  MESSAGE_PACKET request = {HANDSHAKE_MAGIC, 0, buffer};
+  MESSAGE_PACKET message = {UNLOCK_MAGIC, 4, buffer};
+  uint32_t dropped = 0;
+
+  start_line(LINK_MODE_ARQ, 0);
+  for (uint32_t i = 0; i < restarts; i++) {
+    uint32_t requests = peer_requests;
+
+    setup_board_link(LINK_MODE_ARQ);
+    send_board_message(&request);
+    dropped += peer_requests == requests;
+
+    memset(peer_delivered, 0, sizeof(peer_delivered));
+    for (uint32_t j = 0; j < 1 + i % 255; j++) {
+      peer_current = j;
+      memcpy(buffer, &j, sizeof(j));
+      send_board_message(&message);
+    }
+  }
+  simulating = false;
+
+  printf("\n%-10s %8s %10s\n", "restarts", "dropped", "corrupted");
+  printf("%-10u %8u %10u\n", restarts, dropped, peer_bad_numbers);
+
+  if (dropped || peer_bad_numbers) {
+    fprintf(stderr, "link_bench: handshake requests after a restart were "
+                    "dropped\n");
+    exit(1);
+  }
+}
+
+int main(void) {
+  const char *kinds[] = {"noise", "bad-length", "unexpected", "bad-mac"};
+  const double bit_error_rates[] = {1e-6, 1e-5, 1e-4, 1e-3};
+  uint32_t num_kinds = sizeof(kinds) / sizeof(kinds[0]);
+  double ns[sizeof(kinds) / sizeof(kinds[0])];
+
+  hydro_init();
+  hydro_secretbox_keygen(key);
+  setup_board_link(LINK_MODE_ARQ);
+  hydro_secretbox_keygen(other_key);
+
+  for (uint32_t i = 0; i < num_kinds; i++) {
+    ns[i] = bench_junk(kinds[i]);
+  }
+
+  // Every junk frame used to be decrypted, i.e. cost as much as bad-mac
+  printf("%-12s %12s %12s %8s\n", "junk frame", "before ns", "after ns",
+         "speedup");
+  for (uint32_t i = 0; i < num_kinds; i++) {
+    printf("%-12s %12.0f %12.0f %7.1fx\n", kinds[i], ns[num_kinds - 1], ns[i],
+           ns[num_kinds - 1] / ns[i]);
+  }
+
+  printf("\n%-8s %8s %8s %8s\n", "receiver", "bytes", "dropped", "overrun");
+  check_oversize(PAIR_MAGIC, sizeof(PAIR_PACKET));
+  check_oversize(START_MAGIC, sizeof(FEATURE_DATA));
+
+  printf("\n%-10s %9s %8s %10s %12s %12s %10s\n", "bit error", "bad bytes",
+         "lost", "delivered", "recovery ms", "worst ms", "corrupted");
+  for (uint32_t i = 0; i < sizeof(bit_error_rates) / sizeof(double); i++) {
+    bench_recovery(bit_error_rates[i]);
+  }
+
+  // The encrypted messages the link carries, each at its only length
+  const uint8_t magics[] = {UNLOCK_MAGIC, START_MAGIC};
+  const uint8_t lengths[] = {4, sizeof(FEATURE_DATA)};
+
+  printf("\n%-6s %12s %12s %12s\n", "bytes", "encrypt ns", "decrypt ns",
+         "message ns");
+  for (uint32_t i = 0; i < sizeof(magics); i++) {
+    bench_frame_cost(magics[i], lengths[i]);
+  }
+
+  check_restart();
+
+  const double mode_bit_error_rates[] = {0, 1e-5, 1e-4, 1e-3, 3e-3};
+
+  printf("\n%-10s %-5s %6s %12s %10s %10s %10s %8s %10s\n", "bit error",
+         "mode", "bytes", "goodput B/s", "mean ms", "p99 ms", "retx/msg",
+         "gave up", "corrupted");
+  for (uint32_t i = 0; i < sizeof(mode_bit_error_rates) / sizeof(double); i++) {
+    for (uint32_t j = 0; j < sizeof(lengths); j++) {
+      bench_mode(LINK_MODE_ARQ, mode_bit_error_rates[i], magics[j],
+                 lengths[j]);
+      bench_mode(LINK_MODE_FEC, mode_bit_error_rates[i], magics[j],
+                 lengths[j]);
+    }
+  }
+
+  return 0;
+}
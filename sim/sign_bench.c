@@ -0,0 +1,160 @@
+/**
+ * @file sign_bench.c
+ * @brief Host benchmark and cross-check of the car's feature signature checks
+ * @date 2023
+ *
+ * Cross-checks sig_cache_verify() against hydro_sign_verify() on random
+ * feature signatures, valid and tampered with, each checked twice so that the
+ * second check of a valid signature is a cache hit. Then times both on the
+ * feature signatures of one unlock, the first time and after it.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hydrogen.h"
+
+#include "feature_list.h"
+#include "sig_cache.h"
+
+#define CHECK_VECTORS 4000
+#define BENCH_UNLOCKS 2000
+
+// The message the car verifies for each feature
+typedef struct {
+  uint32_t car_id;
+  uint8_t feature;
+} __attribute__((packed)) SIGNED_FEATURE;
+
+static hydro_sign_keypair signing_key;
+
+/**
+ * @brief Sign a random feature, and maybe tamper with the result
+ *
+ * @param message where to store the message
+ * @param signature where to store the signature
+ * @param tamper 0 for a valid signature, otherwise which part to change
+ */
+static void random_vector(SIGNED_FEATURE *message,
+                          uint8_t signature[hydro_sign_BYTES], uint32_t tamper) {
+  hydro_random_buf(message, sizeof(*message));
+  hydro_sign_create(signature, message, sizeof(*message), "feature",
+                    signing_key.sk);
+
+  if (tamper == 1) {
+    signature[hydro_random_u32() % hydro_sign_BYTES] ^=
+        1 << (hydro_random_u32() % 8);
+  } else if (tamper == 2) {
+    message->feature ^= 1 << (hydro_random_u32() % 8);
+  }
+}
+
+/**
+ * @brief Check that both verifiers agree on random vectors
+ *
+ * @return uint32_t the number of disagreements
+ */
+static uint32_t cross_check(void) {
+  uint32_t mismatches = 0;
+
+  for (uint32_t i = 0; i < CHECK_VECTORS; i++) {
+    SIGNED_FEATURE message;
+    uint8_t signature[hydro_sign_BYTES];
+
+    random_vector(&message, signature, i % 3);
+
+    int expected = hydro_sign_verify(signature, &message, sizeof(message),
+                                     "feature", signing_key.pk);
+    for (uint32_t pass = 0; pass < 2; pass++) {
+      if (sig_cache_verify(signature, &message, sizeof(message), "feature",
+                           signing_key.pk) != expected) {
+        mismatches++;
+      }
+    }
+
+    // A valid signature that is then changed must not hit the cache
+    if (expected == 0) {
+      signature[0] ^= 1;
+      if (sig_cache_verify(signature, &message, sizeof(message), "feature",
+                           signing_key.pk) !=
+          hydro_sign_verify(signature, &message, sizeof(message), "feature",
+                            signing_key.pk)) {
+        mismatches++;
+      }
+    }
+  }
+
+  return mismatches;
+}
+
+/**
+ * @brief Time verifying the feature signatures of one unlock, over and over
+ *
+ * @param cached whether to use sig_cache_verify
+ * @param cold whether to empty the cache before every unlock
+ * @return double nanoseconds per signature
+ */
+static double bench_unlocks(bool cached, bool cold) {
+  SIGNED_FEATURE messages[NUM_FEATURES];
+  uint8_t signatures[NUM_FEATURES][hydro_sign_BYTES];
+  struct timespec start, end;
+
+  for (uint32_t i = 0; i < NUM_FEATURES; i++) {
+    random_vector(&messages[i], signatures[i], 0);
+  }
+  sig_cache_init();
+
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+  for (uint32_t unlock = 0; unlock < BENCH_UNLOCKS; unlock++) {
+    if (cold) {
+      sig_cache_init();
+    }
+    for (uint32_t i = 0; i < NUM_FEATURES; i++) {
+      int result =
+          cached ? sig_cache_verify(signatures[i], &messages[i],
+                                    sizeof(messages[i]), "feature",
+                                    signing_key.pk)
+                 : hydro_sign_verify(signatures[i], &messages[i],
+                                     sizeof(messages[i]), "feature",
+                                     signing_key.pk);
+      if (result != 0) {
+        fprintf(stderr, "sign_bench: valid signature rejected\n");
+        exit(1);
+      }
+    }
+  }
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+
+  return ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) /
+         (BENCH_UNLOCKS * NUM_FEATURES);
+}
+
+int main(void) {
+  hydro_init();
+  hydro_sign_keygen(&signing_key);
+  sig_cache_init();
+
+  uint32_t mismatches = cross_check();
+  printf("cross-check: %u vectors, %u mismatches\n", CHECK_VECTORS,
+         mismatches);
+  if (mismatches) {
+    fprintf(stderr, "sign_bench: sig_cache_verify disagrees\n");
+    return 1;
+  }
+
+  double uncached = bench_unlocks(false, false);
+  double cold = bench_unlocks(true, true);
+  double warm = bench_unlocks(true, false);
+
+  printf("\n%-20s %12s %8s\n", "verify", "ns/sig", "speedup");
+  printf("%-20s %12.0f %7.1fx\n", "hydro_sign_verify", uncached, 1.0);
+  printf("%-20s %12.0f %7.1fx\n", "first unlock", cold, uncached / cold);
+  printf("%-20s %12.0f %7.1fx\n", "later unlocks", warm, uncached / warm);
+
+  return 0;
+}
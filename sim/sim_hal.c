@@ -0,0 +1,572 @@
+/**
+ * @file sim_hal.c
+ * @brief Host implementation of the driverlib functions used by the firmware
+ * @date 2023
+ *
+ * Lets the unmodified car and fob sources run as host processes, for soak
+ * testing and for serving simulated boards through the bridge. Only the
+ * driverlib calls made by car/src and fob/src are provided:
+ *
+ *  - The host UART is stdin/stdout and the board link UART is a file
+ *    descriptor or unix socket shared with the other board.
+ *  - SW1 is pressed once for every byte read from --button-fd.
+ *  - Timers count down from their load value at SysCtlClockGet() Hz of host
+ *    monotonic time.
+ *  - EEPROM is a 2 KiB image, loaded from --eeprom or filled with placeholder
+ *    unlock and feature messages.
+ *  - Flash from SIM_FLASH_BASE to the end of the 256 KiB part is mapped at its
+ *    real address so that the fob can read its state through FOB_STATE_PTR. It
+ *    is kept in --flash if given, so that state survives a restart.
+ *  - The hibernation module's memory is kept in --hibernate if given.
+ *    Hibernating exits, and --wake starts the board as woken by the WAKE pin.
+ *
+ * The firmware's main() is compiled as firmware_main() and is run on a
+ * painted stack delimited by _stack_bottom and _stack_top, so stack.c reports
+ * host stack usage in the same way as on the board. Host frames are larger
+ * than Cortex-M frames, so only compare simulated high-water marks with each
+ * other.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include "inc/hw_memmap.h"
+
+#include "driverlib/eeprom.h"
+#include "driverlib/flash.h"
+#include "driverlib/gpio.h"
+#include "driverlib/hibernate.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/timer.h"
+#include "driverlib/uart.h"
+
+#include "stack.h"
+
+#define SIM_CLOCK_HZ 80000000
+#define SIM_EEPROM_SIZE 0x800
+#define SIM_FLASH_BASE 0x20000
+#define SIM_FLASH_END 0x40000
+#define SIM_FLASH_PAGE 0x400
+#define SIM_STACK_SIZE 0x10000
+#define SIM_UART_BUFFER 512
+#define SIM_HIB_WORDS 16
+
+#define SIM_STR(x) #x
+#define SIM_XSTR(x) SIM_STR(x)
+
+// Same placement as the unlock message and features in the car firmware
+#define SIM_UNLOCK_LOC 0x7C0
+#define SIM_FEATURE_SIZE 64
+#define SIM_NUM_FEATURES 3
+
+/**
+ * @brief Buffered host side of a UART
+ */
+typedef struct {
+  int fd;
+  uint8_t rx[SIM_UART_BUFFER];
+  uint32_t rx_off;
+  uint32_t rx_len;
+  uint8_t tx[SIM_UART_BUFFER];
+  uint32_t tx_len;
+} SIM_UART;
+
+static SIM_UART host_uart = {.fd = STDIN_FILENO};
+static SIM_UART board_uart = {.fd = -1};
+static int host_out_fd = STDOUT_FILENO;
+static int button_fd = -1;
+static uint32_t button_reads = 0;
+static bool button_released = true;
+
+// Timer 0, the only timer the firmware uses
+static uint32_t timer_load;
+static struct timespec timer_start;
+
+static uint8_t eeprom[SIM_EEPROM_SIZE];
+
+/**
+ * @brief Hibernation module state, kept in --hibernate across runs
+ */
+typedef struct {
+  uint32_t active; // hibernated since the file was created
+  uint32_t data[SIM_HIB_WORDS];
+} SIM_HIBERNATE;
+
+static SIM_HIBERNATE hib;
+static const char *hib_path;
+static bool hib_wake;
+
+// Stack the firmware runs on, delimited like the _stack section in firmware.ld
+static uint32_t sim_stack[SIM_STACK_SIZE / 4]
+    __attribute__((aligned(16), used));
+__asm__(".globl _stack_bottom\n"
+        ".set _stack_bottom, sim_stack\n"
+        ".globl _stack_top\n"
+        ".set _stack_top, sim_stack + " SIM_XSTR(SIM_STACK_SIZE) "\n");
+
+static ucontext_t sim_context;
+static ucontext_t firmware_context;
+
+int firmware_main(void);
+
+/**
+ * @brief Get the simulated UART for a UART base address
+ *
+ * @param base UART0_BASE for the host UART or UART1_BASE for the board link
+ * @return SIM_UART* the simulated UART
+ */
+static SIM_UART *sim_uart(uint32_t base) {
+  if (base == UART0_BASE) {
+    return &host_uart;
+  } else if (base == UART1_BASE) {
+    return &board_uart;
+  }
+
+  fprintf(stderr, "sim: unsupported UART 0x%08x\n", base);
+  exit(1);
+}
+
+/**
+ * @brief Write out everything queued on a UART
+ */
+static void sim_uart_flush(SIM_UART *uart) {
+  int fd = (uart == &host_uart) ? host_out_fd : uart->fd;
+  uint32_t off = 0;
+
+  while (off < uart->tx_len) {
+    ssize_t n = write(fd, uart->tx + off, uart->tx_len - off);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      // The other end has gone away, as if the board were unplugged
+      exit(0);
+    }
+    off += n;
+  }
+
+  uart->tx_len = 0;
+}
+
+/**
+ * @brief Write out all queued UART output before blocking
+ *
+ * Output must be visible to the other side before the firmware waits for a
+ * response to it.
+ */
+static void sim_flush_all(void) {
+  sim_uart_flush(&host_uart);
+  if (board_uart.fd >= 0) {
+    sim_uart_flush(&board_uart);
+  }
+}
+
+/**
+ * @brief Read more input into a UART's receive buffer
+ *
+ * @param uart the UART to fill
+ * @param block true to wait for input, false to return if there is none
+ * @return true if the buffer holds at least one byte
+ */
+static bool sim_uart_fill(SIM_UART *uart, bool block) {
+  if (uart->rx_off < uart->rx_len) {
+    return true;
+  }
+
+  if (block) {
+    sim_flush_all();
+  } else {
+    struct pollfd pfd = {.fd = uart->fd, .events = POLLIN};
+    if (poll(&pfd, 1, 0) <= 0) {
+      // The firmware is polling for input, so it has finished its output.
+      // Let the other board run, it may be what the firmware is waiting for.
+      sim_flush_all();
+      sched_yield();
+      return false;
+    }
+  }
+
+  ssize_t n;
+  do {
+    n = read(uart->fd, uart->rx, sizeof(uart->rx));
+  } while (n < 0 && errno == EINTR);
+
+  if (n <= 0) {
+    sim_flush_all();
+    exit(0);
+  }
+
+  uart->rx_off = 0;
+  uart->rx_len = n;
+  return true;
+}
+
+/**
+ * @brief Open the board link as a unix socket shared with the other board
+ *
+ * The first board to start listens on the path and the second connects to it.
+ *
+ * @param path path of the socket
+ * @return int the connected socket
+ */
+static int sim_board_socket(const char *path) {
+  struct sockaddr_un addr = {.sun_family = AF_UNIX};
+  strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+    return fd;
+  }
+
+  unlink(path);
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+      listen(fd, 1) < 0) {
+    perror("sim: board socket");
+    exit(1);
+  }
+
+  int conn = accept(fd, NULL, NULL);
+  close(fd);
+  unlink(path);
+  return conn;
+}
+
+/**
+ * @brief Fill the EEPROM with placeholder unlock and feature messages
+ */
+static void sim_eeprom_default(void) {
+  memset(eeprom, 0xFF, sizeof(eeprom));
+
+  snprintf((char *)&eeprom[SIM_UNLOCK_LOC], SIM_FEATURE_SIZE,
+           "%-63s", "Simulated car unlocked");
+
+  for (int i = 1; i <= SIM_NUM_FEATURES; i++) {
+    snprintf((char *)&eeprom[SIM_UNLOCK_LOC - i * SIM_FEATURE_SIZE],
+             SIM_FEATURE_SIZE, "Simulated feature %-45d", i);
+  }
+}
+
+/**
+ * @brief Map the simulated flash at its address on the board
+ *
+ * @param path file holding the flash contents, or NULL for erased flash that
+ * is discarded on exit
+ */
+static void sim_flash_map(const char *path) {
+  size_t size = SIM_FLASH_END - SIM_FLASH_BASE;
+  int flags = MAP_FIXED_NOREPLACE | MAP_SHARED;
+  int fd = -1;
+  bool erase = true;
+
+  if (path) {
+    fd = open(path, O_RDWR | O_CREAT, 0644);
+    off_t existing = (fd < 0) ? -1 : lseek(fd, 0, SEEK_END);
+    if (existing < 0 || ftruncate(fd, size) < 0) {
+      perror("sim: flash file");
+      exit(1);
+    }
+    erase = (existing != (off_t)size);
+  } else {
+    flags |= MAP_ANONYMOUS;
+  }
+
+  void *flash = mmap((void *)SIM_FLASH_BASE, size, PROT_READ | PROT_WRITE,
+                     flags, fd, 0);
+  if (flash != (void *)SIM_FLASH_BASE) {
+    perror("sim: mapping flash");
+    exit(1);
+  }
+
+  if (erase) {
+    memset(flash, 0xFF, size);
+  }
+}
+
+/**
+ * @brief Entry point of the simulated board
+ *
+ * Usage: car_sim|fob_sim [--board-fd FD | --board-socket PATH]
+ *        [--button-fd FD] [--eeprom FILE] [--flash FILE] [--hibernate FILE]
+ *        [--wake]
+ */
+int main(int argc, char **argv) {
+  const char *eeprom_path = NULL;
+  const char *flash_path = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    bool has_value = (i + 1 < argc);
+
+    if (has_value && !strcmp(argv[i], "--board-fd")) {
+      board_uart.fd = atoi(argv[++i]);
+    } else if (has_value && !strcmp(argv[i], "--board-socket")) {
+      board_uart.fd = sim_board_socket(argv[++i]);
+    } else if (has_value && !strcmp(argv[i], "--button-fd")) {
+      button_fd = atoi(argv[++i]);
+    } else if (has_value && !strcmp(argv[i], "--eeprom")) {
+      eeprom_path = argv[++i];
+    } else if (has_value && !strcmp(argv[i], "--flash")) {
+      flash_path = argv[++i];
+    } else if (has_value && !strcmp(argv[i], "--hibernate")) {
+      hib_path = argv[++i];
+    } else if (!strcmp(argv[i], "--wake")) {
+      hib_wake = true;
+    } else {
+      fprintf(stderr,
+              "usage: %s [--board-fd FD | --board-socket PATH] "
+              "[--button-fd FD] [--eeprom FILE] [--flash FILE] "
+              "[--hibernate FILE] [--wake]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+
+  if (board_uart.fd < 0) {
+    fprintf(stderr, "sim: no board link, use --board-fd or --board-socket\n");
+    return 1;
+  }
+
+  signal(SIGPIPE, SIG_IGN);
+
+  sim_eeprom_default();
+  if (eeprom_path) {
+    FILE *f = fopen(eeprom_path, "rb");
+    if (f == NULL) {
+      perror("sim: eeprom file");
+      return 1;
+    }
+    fread(eeprom, 1, sizeof(eeprom), f);
+    fclose(f);
+  }
+
+  sim_flash_map(flash_path);
+
+  if (hib_path) {
+    FILE *f = fopen(hib_path, "rb");
+    if (f) {
+      fread(&hib, 1, sizeof(hib), f);
+      fclose(f);
+    }
+  }
+
+  // Paint the stack as Firmware_Startup does, then run the firmware on it
+  for (uint32_t i = 0; i < SIM_STACK_SIZE / 4; i++) {
+    sim_stack[i] = STACK_PAINT_PATTERN;
+  }
+
+  getcontext(&firmware_context);
+  firmware_context.uc_stack.ss_sp = sim_stack;
+  firmware_context.uc_stack.ss_size = sizeof(sim_stack);
+  firmware_context.uc_link = &sim_context;
+  makecontext(&firmware_context, (void (*)(void))firmware_main, 0);
+  swapcontext(&sim_context, &firmware_context);
+
+  sim_flush_all();
+  return 0;
+}
+
+/*** driverlib ***/
+
+void SysCtlPeripheralEnable(uint32_t ui32Peripheral) {}
+
+void SysCtlPeripheralDisable(uint32_t ui32Peripheral) {}
+
+uint32_t SysCtlClockGet(void) { return SIM_CLOCK_HZ; }
+
+void GPIOPinConfigure(uint32_t ui32PinConfig) {}
+
+void GPIOPinTypeUART(uint32_t ui32Port, uint8_t ui8Pins) {}
+
+void GPIOPinTypeGPIOInput(uint32_t ui32Port, uint8_t ui8Pins) {}
+
+void GPIOPadConfigSet(uint32_t ui32Port, uint8_t ui8Pins,
+                      uint32_t ui32Strength, uint32_t ui32PadType) {}
+
+void GPIOPinWrite(uint32_t ui32Port, uint8_t ui8Pins, uint8_t ui8Val) {}
+
+/**
+ * @brief Read SW1 (PF4, active low)
+ *
+ * The fob polls SW1 and the host UART in a loop, so while SW1 is released
+ * this waits for either a button press or host input instead of spinning. A
+ * press reads low twice, to pass the fob's debounce check, and is followed by
+ * at least one released read.
+ */
+int32_t GPIOPinRead(uint32_t ui32Port, uint8_t ui8Pins) {
+  if (ui32Port != GPIO_PORTF_BASE || !(ui8Pins & GPIO_PIN_4)) {
+    return 0;
+  }
+
+  if (button_reads > 0) {
+    button_reads--;
+    return 0;
+  }
+
+  // Read released once after a press so the next press is an edge
+  if (button_fd < 0 || !button_released ||
+      host_uart.rx_off < host_uart.rx_len) {
+    button_released = true;
+    return ui8Pins;
+  }
+
+  sim_flush_all();
+
+  struct pollfd pfds[2] = {{.fd = host_uart.fd, .events = POLLIN},
+                           {.fd = button_fd, .events = POLLIN}};
+  while (poll(pfds, 2, -1) < 0 && errno == EINTR)
+    ;
+
+  if (pfds[1].revents) {
+    uint8_t press;
+    if (read(button_fd, &press, 1) <= 0) {
+      exit(0);
+    }
+    button_reads = 1;
+    button_released = false;
+    return 0;
+  }
+
+  return ui8Pins;
+}
+
+void UARTConfigSetExpClk(uint32_t ui32Base, uint32_t ui32UARTClk,
+                         uint32_t ui32Baud, uint32_t ui32Config) {}
+
+bool UARTCharsAvail(uint32_t ui32Base) {
+  return sim_uart_fill(sim_uart(ui32Base), false);
+}
+
+int32_t UARTCharGet(uint32_t ui32Base) {
+  SIM_UART *uart = sim_uart(ui32Base);
+
+  sim_uart_fill(uart, true);
+  return uart->rx[uart->rx_off++];
+}
+
+void UARTCharPut(uint32_t ui32Base, unsigned char ucData) {
+  SIM_UART *uart = sim_uart(ui32Base);
+
+  if (uart->tx_len == sizeof(uart->tx)) {
+    sim_uart_flush(uart);
+  }
+  uart->tx[uart->tx_len++] = ucData;
+}
+
+bool UARTBusy(uint32_t ui32Base) { return false; }
+
+uint32_t HibernateIsActive(void) { return hib.active; }
+
+void HibernateEnableExpClk(uint32_t ui32HibClk) {}
+
+uint32_t HibernateIntStatus(bool bMasked) {
+  return (hib.active && hib_wake) ? HIBERNATE_INT_PIN_WAKE : 0;
+}
+
+void HibernateIntClear(uint32_t ui32IntFlags) {
+  if (ui32IntFlags & HIBERNATE_INT_PIN_WAKE) {
+    hib_wake = false;
+  }
+}
+
+void HibernateDataGet(uint32_t *pui32Data, uint32_t ui32Count) {
+  memcpy(pui32Data, hib.data, ui32Count * sizeof(uint32_t));
+}
+
+void HibernateDataSet(uint32_t *pui32Data, uint32_t ui32Count) {
+  memcpy(hib.data, pui32Data, ui32Count * sizeof(uint32_t));
+}
+
+void HibernateWakeSet(uint32_t ui32WakeFlags) {}
+
+/**
+ * @brief Hibernate: keep the hibernation memory and power down, by exiting
+ */
+void HibernateRequest(void) {
+  hib.active = 1;
+
+  if (hib_path) {
+    FILE *f = fopen(hib_path, "wb");
+    if (f == NULL || fwrite(&hib, 1, sizeof(hib), f) != sizeof(hib)) {
+      perror("sim: hibernate file");
+    }
+    if (f) {
+      fclose(f);
+    }
+  }
+
+  sim_flush_all();
+  exit(0);
+}
+
+void TimerConfigure(uint32_t ui32Base, uint32_t ui32Config) {}
+
+void TimerLoadSet(uint32_t ui32Base, uint32_t ui32Timer, uint32_t ui32Value) {
+  timer_load = ui32Value;
+}
+
+void TimerEnable(uint32_t ui32Base, uint32_t ui32Timer) {
+  clock_gettime(CLOCK_MONOTONIC, &timer_start);
+}
+
+uint32_t TimerValueGet(uint32_t ui32Base, uint32_t ui32Timer) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  uint64_t ns = (now.tv_sec - timer_start.tv_sec) * 1000000000ULL +
+                now.tv_nsec - timer_start.tv_nsec;
+  return timer_load - (uint32_t)(ns * (SIM_CLOCK_HZ / 1000000) / 1000);
+}
+
+uint32_t EEPROMInit(void) { return EEPROM_INIT_OK; }
+
+void EEPROMRead(uint32_t *pui32Data, uint32_t ui32Address, uint32_t ui32Count) {
+  if (ui32Address + ui32Count > sizeof(eeprom)) {
+    fprintf(stderr, "sim: EEPROM read out of range 0x%x\n", ui32Address);
+    exit(1);
+  }
+
+  memcpy(pui32Data, &eeprom[ui32Address], ui32Count);
+}
+
+int32_t FlashErase(uint32_t ui32Address) {
+  if (ui32Address < SIM_FLASH_BASE || ui32Address >= SIM_FLASH_END ||
+      ui32Address % SIM_FLASH_PAGE) {
+    return -1;
+  }
+
+  memset((void *)(uintptr_t)ui32Address, 0xFF, SIM_FLASH_PAGE);
+  return 0;
+}
+
+/**
+ * @brief Program flash, which like the real part can only clear bits
+ */
+int32_t FlashProgram(uint32_t *pui32Data, uint32_t ui32Address,
+                     uint32_t ui32Count) {
+  if (ui32Address < SIM_FLASH_BASE || ui32Address + ui32Count > SIM_FLASH_END ||
+      ui32Address % 4 || ui32Count % 4) {
+    return -1;
+  }
+
+  uint32_t *flash = (uint32_t *)(uintptr_t)ui32Address;
+  for (uint32_t i = 0; i < ui32Count / 4; i++) {
+    flash[i] &= pui32Data[i];
+  }
+
+  return 0;
+}
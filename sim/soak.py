@@ -0,0 +1,811 @@
+#!/usr/bin/python3 -u
+
+# @file soak.py
+# @brief Soak and load benchmark for repeated unlock cycles on simulated boards
+# @date 2023
+#
+# Starts the simulated car and paired fob built by sim/Makefile, connected by a
+# socket pair, enables --features features on the fob and then presses SW1
+# --cycles times. Each cycle is the full handshake -> unlock -> start exchange
+# and is timed from the button press to the car's end of unlock trailer.
+#
+# Results are written as JSON: latency percentiles and a histogram, failures by
+# kind, throughput, the stack high-water marks reported by both boards and the
+# peak resident memory of both processes. They are compared against a stored
+# baseline, and any regression beyond the tolerances makes the run fail.
+#
+# A timed out cycle restarts both boards. The fob keeps its state in a flash
+# file, so the enabled features survive the restart.
+#
+# With --loss, the board link is relayed through this script, which drops that
+# fraction of the frames in each direction to measure how many unlocks per
+# second the link's retransmissions keep up under loss.
+#
+# With --commit-stream, the features are instead enabled one at a time on a
+# fob with erased flash, and while each one is written to flash the fob is
+# also sent a button press and --link-reports link commands, without waiting
+# for the enable to finish. Every reply must arrive, and the features must
+# still be enabled after a restart. The simulated fob has no UART receive ring
+# and its flash writes take no time, so the overrun counters of its link
+# reports are always zero here, and only the board's `link` command can show
+# overruns during a real flash write.
+#
+# With --hibernate-resume, the fob is instead booted cold, pressed once, sent
+# the hibernate command and woken by its wake button, --wakes times. A wake
+# must unlock the car by itself. The time from board link setup to the first
+# handshake request of a resume is compared with that of a cold boot, which
+# is its time to ready plus the time from the press to the request.
+
+import argparse
+import json
+import os
+import random
+import re
+import socket
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+from pathlib import Path
+
+# End of unlock trailer written by the car, see unlock_tool
+TRAILER_RE = re.compile(rb"\r\n%%UNLOCK-END ([SFR]) ([0-9a-f]{8})\r\n")
+STACK_RE = re.compile(rb"Stack high-water mark: 0x([0-9a-f]{8}) / 0x([0-9a-f]{8})")
+ARQ_RE = re.compile(
+    rb"Link arq: sent 0x([0-9a-f]{8}) retransmits 0x([0-9a-f]{8}) gave_up 0x([0-9a-f]{8})"
+)
+# Boot reports of the fob, see boot_report
+COLD_READY_RE = re.compile(rb"Boot: cold ready ticks 0x([0-9a-f]{8})")
+RESUME_RE = re.compile(rb"Boot: resume first frame ticks 0x([0-9a-f]{8})")
+PRESS_RE = re.compile(rb"Unlock: press to first frame ticks 0x([0-9a-f]{8})")
+
+# Simulated system clock, SIM_CLOCK_HZ in sim_hal.c
+SIM_CLOCK_HZ = 80000000
+
+# enable-batch status characters, each after a prefix byte that debug output
+# never contains
+ENABLE_STATUS_RE = re.compile(rb"\x06([0-5])")
+
+# The end of an enable-batch, not the "Enable Feature Batch" debug header
+BATCH_RE = re.compile(rb"(?<!Feature )Batch")
+
+# An enable-batch status, its end, or the UART line of a link report
+COMMIT_STREAM_RE = re.compile(
+    rb"\x06([0-5])|(?<!Feature )(Batch)"
+    rb"|Link uart: host_overruns 0x[0-9a-f]{8} board_overruns 0x[0-9a-f]{8}"
+)
+
+# Upper bounds of the latency histogram buckets, in ms
+HISTOGRAM_BOUNDS_MS = [
+    0.1, 0.2, 0.5, 1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000,
+]
+
+# Metric, direction of a regression, and the tolerance it is checked with
+BASELINE_CHECKS = [
+    ("latency_ms.p50", "higher", "latency"),
+    ("latency_ms.p99", "higher", "latency"),
+    ("latency_ms.mean", "higher", "latency"),
+    ("throughput_cycles_per_s", "lower", "latency"),
+    ("failures.total", "higher", "absolute"),
+    ("car.stack_high_water_bytes", "higher", "stack"),
+    ("fob.stack_high_water_bytes", "higher", "stack"),
+    ("car.max_rss_kib", "higher", "rss"),
+    ("fob.max_rss_kib", "higher", "rss"),
+]
+
+
+# @brief Error raised when a board does not respond in time
+class BoardTimeout(Exception):
+    pass
+
+
+# @brief Output of a simulated board, collected by a background thread
+class BoardOutput:
+    def __init__(self, stream):
+        self.stream = stream
+        self.buffer = bytearray()
+        self.cond = threading.Condition()
+        self.closed = False
+        threading.Thread(target=self._reader, daemon=True).start()
+
+    def _reader(self):
+        while True:
+            data = self.stream.read1(65536)
+            with self.cond:
+                if not data:
+                    self.closed = True
+                    self.cond.notify_all()
+                    return
+                self.buffer += data
+                self.cond.notify_all()
+
+    # @brief Wait for a regex and consume the output up to the end of the match
+    # @param pattern, compiled bytes regex
+    # @param timeout, seconds to wait before failing
+    # @return the match object
+    def expect(self, pattern, timeout):
+        deadline = time.monotonic() + timeout
+        with self.cond:
+            while True:
+                match = pattern.search(self.buffer)
+                if match:
+                    # Re-match on a copy, the match refers to the live buffer
+                    consumed = bytes(self.buffer[: match.end()])
+                    del self.buffer[: match.end()]
+                    return pattern.search(consumed, match.start())
+                remaining = deadline - time.monotonic()
+                if self.closed or remaining <= 0:
+                    raise BoardTimeout(f"timed out waiting for {pattern.pattern!r}")
+                self.cond.wait(remaining)
+
+    # @brief Drop all output received so far
+    def clear(self):
+        with self.cond:
+            self.buffer.clear()
+
+
+# @brief Board link relay that drops whole frames at random
+#
+# Frames are found by their zero delimiters and forwarded once complete, so a
+# dropped frame never reaches the other board at all.
+class LossyLink:
+    def __init__(self, loss, rng):
+        self.car_end, car_relay = socket.socketpair()
+        self.fob_end, fob_relay = socket.socketpair()
+        self.loss = loss
+        self.rng = rng
+        self.frames = 0
+        self.dropped = 0
+        for src, dst in ((car_relay, fob_relay), (fob_relay, car_relay)):
+            threading.Thread(target=self._relay, args=(src, dst), daemon=True).start()
+
+    def _relay(self, src, dst):
+        partial = b""
+        while True:
+            try:
+                data = src.recv(65536)
+            except OSError:
+                data = b""
+            if not data:
+                for sock in (src, dst):
+                    try:
+                        sock.shutdown(socket.SHUT_RDWR)
+                    except OSError:
+                        pass
+                return
+
+            # Every part but the last is followed by a delimiter
+            parts = (partial + data).split(b"\x00")
+            partial = parts.pop()
+            out = bytearray()
+            for frame in parts:
+                if frame:
+                    self.frames += 1
+                    if self.rng.random() < self.loss:
+                        self.dropped += 1
+                        frame = b""
+                out += frame + b"\x00"
+
+            try:
+                dst.sendall(out)
+            except OSError:
+                pass
+
+
+# @brief A simulated car and paired fob connected by their board link
+class SimulatedPair:
+    def __init__(self, build_dir, flash_file, loss=0, rng=None, hibernate_file=None, wake=False):
+        if loss:
+            self.link = LossyLink(loss, rng)
+            car_link, fob_link = self.link.car_end, self.link.fob_end
+        else:
+            self.link = None
+            car_link, fob_link = socket.socketpair()
+        button_read, self.button = os.pipe()
+
+        fob_hibernate = []
+        if hibernate_file:
+            fob_hibernate = ["--hibernate", str(hibernate_file)]
+            if wake:
+                fob_hibernate.append("--wake")
+
+        self.car = subprocess.Popen(
+            [build_dir / "car_sim", "--board-fd", str(car_link.fileno())],
+            stdin=subprocess.PIPE,
+            stdout=subprocess.PIPE,
+            pass_fds=[car_link.fileno()],
+        )
+        self.fob = subprocess.Popen(
+            [
+                build_dir / "fob_sim",
+                "--board-fd", str(fob_link.fileno()),
+                "--button-fd", str(button_read),
+                "--flash", str(flash_file),
+                *fob_hibernate,
+            ],
+            stdin=subprocess.PIPE,
+            stdout=subprocess.PIPE,
+            pass_fds=[fob_link.fileno(), button_read],
+        )
+
+        car_link.close()
+        fob_link.close()
+        os.close(button_read)
+
+        self.car_out = BoardOutput(self.car.stdout)
+        self.fob_out = BoardOutput(self.fob.stdout)
+
+    # @brief Press SW1 on the fob
+    def press_button(self):
+        os.write(self.button, b"\x01")
+
+    # @brief Send a host command to the fob
+    def fob_command(self, data):
+        self.fob.stdin.write(data)
+        self.fob.stdin.flush()
+
+    # @brief Get the peak resident memory of a board process in KiB
+    @staticmethod
+    def max_rss_kib(process):
+        try:
+            with open(f"/proc/{process.pid}/status", "r") as f:
+                for line in f:
+                    if line.startswith("VmHWM:"):
+                        return int(line.split()[1])
+        except OSError:
+            pass
+        return None
+
+    # @brief Stop both boards
+    #
+    # The fob exits once its button is closed, and the car once the board link
+    # is, so that builds with PGO=generate write their profiles. Boards that
+    # are stuck are killed.
+    def close(self):
+        os.close(self.button)
+        for process in (self.fob, self.car):
+            try:
+                process.wait(timeout=2)
+            except subprocess.TimeoutExpired:
+                process.kill()
+                process.wait()
+
+
+# @brief Sign feature packages 1 to features for a car
+# @return list of packages
+def sign_features(build_dir, car_id, features):
+    packages = []
+    with tempfile.TemporaryDirectory() as tmp:
+        for feature in range(1, features + 1):
+            package = Path(tmp) / f"feature{feature}.bin"
+            subprocess.run(
+                [
+                    build_dir / "sign_feature",
+                    str(car_id),
+                    str(feature),
+                    build_dir / "secrets" / "signing_secret_key.txt",
+                    package,
+                ],
+                check=True,
+            )
+            packages.append(package.read_bytes())
+    return packages
+
+
+# @brief Enable features on the fob with one enable-batch transaction
+def enable_features(pair, build_dir, car_id, features, timeout):
+    if features == 0:
+        return
+
+    packages = sign_features(build_dir, car_id, features)
+
+    pair.fob_out.clear()
+    pair.fob_command(b"enable-batch\n" + bytes([len(packages)]))
+    for package in packages:
+        pair.fob_command(package)
+        status = pair.fob_out.expect(ENABLE_STATUS_RE, timeout).group(1)
+        # A duplicate means the flash file already holds the feature
+        if status not in (b"0", b"4"):
+            sys.exit(f"ERROR: fob rejected feature package with status {status!r}")
+    pair.fob_out.expect(BATCH_RE, timeout)
+
+
+# @brief Get a percentile of a sorted list by nearest rank
+def percentile(sorted_values, fraction):
+    if not sorted_values:
+        return None
+    index = min(len(sorted_values) - 1, int(fraction * len(sorted_values)))
+    return sorted_values[index]
+
+
+# @brief Bucket latencies into the fixed histogram bounds
+def histogram(latencies_ms):
+    counts = [0] * (len(HISTOGRAM_BOUNDS_MS) + 1)
+    for latency in latencies_ms:
+        for i, bound in enumerate(HISTOGRAM_BOUNDS_MS):
+            if latency <= bound:
+                counts[i] += 1
+                break
+        else:
+            counts[-1] += 1
+
+    bounds = HISTOGRAM_BOUNDS_MS + ["inf"]
+    return [{"le_ms": b, "count": c} for b, c in zip(bounds, counts)]
+
+
+# @brief Run the soak benchmark
+# @return results dictionary
+def soak(args):
+    flash_file = Path(tempfile.mkstemp(prefix="soak_fob_flash_")[1])
+    flash_file.unlink()
+
+    latencies = []
+    failures = {"timeout": 0, "start_failed": 0, "rejected": 0}
+    restarts = 0
+    car_stack = (0, None)
+    fob_stack = (0, None)
+    car_rss = 0
+    fob_rss = 0
+    rng = random.Random(args.seed)
+    link = {"frames": 0, "dropped": 0}
+    arq = {
+        board: {"sent": 0, "retransmits": 0, "gave_up": 0} for board in ("car", "fob")
+    }
+    car_arq = None
+
+    # @brief Add the link counters of a pair that is being stopped to the totals
+    def count_link(pair, car_arq, fob_arq):
+        if pair.link:
+            link["frames"] += pair.link.frames
+            link["dropped"] += pair.link.dropped
+        for board, match in (("car", car_arq), ("fob", fob_arq)):
+            if match:
+                for i, name in enumerate(("sent", "retransmits", "gave_up")):
+                    arq[board][name] += int(match.group(i + 1), 16)
+
+    pair = SimulatedPair(args.build_dir, flash_file, args.loss, rng)
+    try:
+        enable_features(pair, args.build_dir, args.car_id, args.features, args.timeout)
+
+        start = time.perf_counter()
+        for cycle in range(args.cycles):
+            press = time.perf_counter()
+            pair.press_button()
+
+            try:
+                # The car reports its stack right before each trailer
+                stack = pair.car_out.expect(STACK_RE, args.timeout)
+                car_stack = max(car_stack, (int(stack.group(1), 16), int(stack.group(2), 16)))
+
+                # Then its board link counters, which count up from its start
+                car_arq = pair.car_out.expect(ARQ_RE, args.timeout)
+
+                trailer = pair.car_out.expect(TRAILER_RE, args.timeout)
+                latencies.append((time.perf_counter() - press) * 1000)
+            except BoardTimeout:
+                failures["timeout"] += 1
+                car_rss = max(car_rss, pair.max_rss_kib(pair.car) or 0)
+                fob_rss = max(fob_rss, pair.max_rss_kib(pair.fob) or 0)
+                pair.close()
+                count_link(pair, car_arq, None)
+                car_arq = None
+                pair = SimulatedPair(args.build_dir, flash_file, args.loss, rng)
+                restarts += 1
+                continue
+
+            if trailer.group(1) == b"F":
+                failures["start_failed"] += 1
+            elif trailer.group(1) == b"R":
+                failures["rejected"] += 1
+
+            # Keep the fob's debug output from piling up
+            pair.fob_out.clear()
+
+            if args.progress and (cycle + 1) % args.progress == 0:
+                print(f"{cycle + 1}/{args.cycles} cycles", file=sys.stderr)
+
+        elapsed = time.perf_counter() - start
+
+        pair.fob_out.clear()
+        pair.fob_command(b"stack\n")
+        stack = pair.fob_out.expect(STACK_RE, args.timeout)
+        fob_stack = (int(stack.group(1), 16), int(stack.group(2), 16))
+
+        pair.fob_command(b"link\n")
+        fob_arq = pair.fob_out.expect(ARQ_RE, args.timeout)
+
+        car_rss = max(car_rss, pair.max_rss_kib(pair.car) or 0)
+        fob_rss = max(fob_rss, pair.max_rss_kib(pair.fob) or 0)
+    finally:
+        pair.close()
+        if flash_file.exists():
+            flash_file.unlink()
+
+    count_link(pair, car_arq, fob_arq)
+
+    latencies.sort()
+    failures["total"] = sum(failures.values())
+    return {
+        "config": {
+            "cycles": args.cycles,
+            "features": args.features,
+            "timeout_s": args.timeout,
+            "loss": args.loss,
+        },
+        "completed": len(latencies),
+        "failures": failures,
+        "restarts": restarts,
+        "elapsed_s": round(elapsed, 3),
+        "throughput_cycles_per_s": round(len(latencies) / elapsed, 1) if elapsed else None,
+        "latency_ms": {
+            name: round(value, 4) if value is not None else None
+            for name, value in (
+                ("min", percentile(latencies, 0)),
+                ("mean", sum(latencies) / len(latencies) if latencies else None),
+                ("p50", percentile(latencies, 0.50)),
+                ("p90", percentile(latencies, 0.90)),
+                ("p99", percentile(latencies, 0.99)),
+                ("p999", percentile(latencies, 0.999)),
+                ("max", latencies[-1] if latencies else None),
+            )
+        },
+        "latency_histogram": histogram(latencies),
+        "car": {
+            "stack_high_water_bytes": car_stack[0],
+            "stack_size_bytes": car_stack[1],
+            "max_rss_kib": car_rss,
+        },
+        "fob": {
+            "stack_high_water_bytes": fob_stack[0],
+            "stack_size_bytes": fob_stack[1],
+            "max_rss_kib": fob_rss,
+        },
+        "link": {
+            "frames": link["frames"],
+            "dropped": link["dropped"],
+            "car": arq["car"],
+            "fob": arq["fob"],
+        },
+    }
+
+
+# @brief Enable features one at a time while streaming other traffic to the fob
+# @return results dictionary
+def commit_stream(args):
+    flash_file = Path(tempfile.mkstemp(prefix="soak_fob_flash_")[1])
+    flash_file.unlink()
+
+    packages = sign_features(args.build_dir, args.car_id, args.features)
+    failures = []
+    unlocks = 0
+    reports = 0
+
+    pair = SimulatedPair(args.build_dir, flash_file)
+    try:
+        for feature, package in enumerate(packages, 1):
+            pair.fob_out.clear()
+            pair.car_out.clear()
+
+            # Everything is sent before the fob has verified the package
+            pair.fob_command(b"enable-batch\n" + bytes([1]) + package)
+            pair.press_button()
+            pair.fob_command(b"link\n" * args.link_reports)
+
+            # Link reports may come before, between or after the enable status
+            # and the end of the batch
+            batch = False
+            try:
+                for _ in range(args.link_reports + 2):
+                    match = pair.fob_out.expect(COMMIT_STREAM_RE, args.timeout)
+                    if match.group(1) is not None:
+                        if match.group(1) != b"0":
+                            failures.append(
+                                f"feature {feature}: enable status {match.group(1)!r}"
+                            )
+                    elif match.group(2) is not None:
+                        batch = True
+                    else:
+                        reports += 1
+                if not batch:
+                    failures.append(f"feature {feature}: no Batch")
+                pair.car_out.expect(TRAILER_RE, args.timeout)
+                unlocks += 1
+            except BoardTimeout as e:
+                failures.append(f"feature {feature}: {e}")
+                break
+    finally:
+        pair.close()
+
+    # A restarted fob reads its state back from flash, so every feature is a
+    # duplicate, or does not fit if all of them are enabled
+    persisted = 0
+    pair = SimulatedPair(args.build_dir, flash_file)
+    try:
+        pair.fob_command(b"enable-batch\n" + bytes([len(packages)]) + b"".join(packages))
+        statuses = pair.fob_out.expect(
+            re.compile(rb"((?:\x06[0-5]){%d})Batch" % len(packages)), args.timeout
+        ).group(1)[1::2]
+        for feature, status in enumerate(statuses, 1):
+            if status in b"34":
+                persisted += 1
+            else:
+                failures.append(f"feature {feature}: status {chr(status)!r} after restart")
+    except BoardTimeout as e:
+        failures.append(f"after restart: {e}")
+    finally:
+        pair.close()
+        if flash_file.exists():
+            flash_file.unlink()
+
+    return {
+        "config": {
+            "features": args.features,
+            "link_reports": args.link_reports,
+            "timeout_s": args.timeout,
+        },
+        "unlocks": unlocks,
+        "link_reports": reports,
+        "persisted": persisted,
+        "failures": failures,
+    }
+
+
+# @brief Boot the fob cold and resume it from hibernation, in turns
+# @return results dictionary
+def hibernate_resume(args):
+    tmp = tempfile.TemporaryDirectory(prefix="soak_hibernate_")
+    flash_file = Path(tmp.name) / "flash"
+    hibernate_file = Path(tmp.name) / "hibernate"
+
+    cold_ms = []
+    press_ms = []
+    resume_ms = []
+    unlocks = 0
+    failures = []
+
+    # @brief Ticks of a boot report, in ms
+    def boot_ms(match):
+        return int(match.group(1), 16) * 1000 / SIM_CLOCK_HZ
+
+    # @brief Send the hibernate command and wait for the fob to power down
+    def hibernate(pair):
+        pair.fob_command(b"hibernate\n")
+        pair.fob.wait(timeout=args.timeout)
+
+    try:
+        for wake in range(args.wakes):
+            pair = SimulatedPair(args.build_dir, flash_file, hibernate_file=hibernate_file)
+            try:
+                cold_ms.append(boot_ms(pair.fob_out.expect(COLD_READY_RE, args.timeout)))
+                if wake == 0:
+                    enable_features(
+                        pair, args.build_dir, args.car_id, args.features, args.timeout
+                    )
+                pair.press_button()
+                pair.car_out.expect(TRAILER_RE, args.timeout)
+                press_ms.append(boot_ms(pair.fob_out.expect(PRESS_RE, args.timeout)))
+                hibernate(pair)
+            except (BoardTimeout, subprocess.TimeoutExpired) as e:
+                failures.append(f"cold boot {wake}: {e}")
+                continue
+            finally:
+                pair.close()
+
+            # The wake button press alone unlocks the car
+            pair = SimulatedPair(
+                args.build_dir, flash_file, hibernate_file=hibernate_file, wake=True
+            )
+            try:
+                resume_ms.append(boot_ms(pair.fob_out.expect(RESUME_RE, args.timeout)))
+                trailer = pair.car_out.expect(TRAILER_RE, args.timeout)
+                if trailer.group(1) == b"S":
+                    unlocks += 1
+                else:
+                    failures.append(f"resume {wake}: unlock trailer {trailer.group(1)!r}")
+                hibernate(pair)
+            except (BoardTimeout, subprocess.TimeoutExpired) as e:
+                failures.append(f"resume {wake}: {e}")
+            finally:
+                pair.close()
+    finally:
+        tmp.cleanup()
+
+    # @brief Mean, minimum and maximum of a list of times
+    def summary(values):
+        if not values:
+            return None
+        return {
+            "mean": round(sum(values) / len(values), 4),
+            "min": round(min(values), 4),
+            "max": round(max(values), 4),
+        }
+
+    return {
+        "config": {
+            "wakes": args.wakes,
+            "features": args.features,
+            "timeout_s": args.timeout,
+        },
+        "unlocks": unlocks,
+        "cold_ready_ms": summary(cold_ms),
+        "press_to_first_frame_ms": summary(press_ms),
+        "cold_first_frame_ms": summary([c + p for c, p in zip(cold_ms, press_ms)]),
+        "resume_first_frame_ms": summary(resume_ms),
+        "failures": failures,
+    }
+
+
+# @brief Look up a dotted metric name in a results dictionary
+def metric(results, name):
+    value = results
+    for key in name.split("."):
+        if not isinstance(value, dict) or key not in value:
+            return None
+        value = value[key]
+    return value
+
+
+# @brief Compare results against a baseline
+# @return list of regression descriptions
+def regressions(results, baseline, tolerances):
+    found = []
+    for name, worse, kind in BASELINE_CHECKS:
+        current, previous = metric(results, name), metric(baseline, name)
+        if current is None or previous is None:
+            continue
+
+        if kind == "absolute":
+            limit = previous
+        elif worse == "higher":
+            limit = previous * (1 + tolerances[kind])
+        else:
+            limit = previous * (1 - tolerances[kind])
+
+        if (worse == "higher" and current > limit) or (worse == "lower" and current < limit):
+            found.append(f"{name}: {current:.6g} vs baseline {previous:.6g}")
+    return found
+
+
+# @brief Main function
+#
+# Main function handles parsing arguments, running the benchmark and checking
+# the results against the baseline. Exits non-zero on any failed cycle when no
+# baseline is given, or on any regression against the baseline.
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument(
+        "--build-dir", help="sim/Makefile build directory", type=Path, default="build",
+    )
+    parser.add_argument(
+        "--car-id", help="Car ID the simulated boards were built with", type=int, default=1,
+    )
+    parser.add_argument("--cycles", help="Unlock cycles to run", type=int, default=20000)
+    parser.add_argument(
+        "--features", help="Features to enable before the run", type=int, default=3,
+    )
+    parser.add_argument(
+        "--timeout", help="Seconds to wait for each cycle", type=float, default=5,
+    )
+    parser.add_argument(
+        "--loss", help="Fraction of board link frames to drop", type=float, default=0,
+    )
+    parser.add_argument(
+        "--seed", help="Seed for the frames dropped by --loss", type=int, default=1,
+    )
+    parser.add_argument("--results", help="JSON results output file", type=Path)
+    parser.add_argument("--baseline", help="Baseline JSON results file", type=Path)
+    parser.add_argument(
+        "--save-baseline",
+        help="Store the results as the new baseline instead of comparing",
+        action="store_true",
+    )
+    parser.add_argument(
+        "--latency-tolerance",
+        help="Allowed relative slowdown in latency and throughput",
+        type=float,
+        default=0.25,
+    )
+    parser.add_argument(
+        "--stack-tolerance",
+        help="Allowed relative growth in stack high-water marks",
+        type=float,
+        default=0.0,
+    )
+    parser.add_argument(
+        "--rss-tolerance",
+        help="Allowed relative growth in peak resident memory",
+        type=float,
+        default=0.1,
+    )
+    parser.add_argument(
+        "--progress", help="Report progress every N cycles", type=int, default=0,
+    )
+    parser.add_argument(
+        "--summary", help="Print a one line summary instead of the results", action="store_true",
+    )
+    parser.add_argument(
+        "--commit-stream",
+        help="Stream unlocks and link reports to the fob while it writes each feature to flash",
+        action="store_true",
+    )
+    parser.add_argument(
+        "--link-reports",
+        help="Link commands sent to the fob during each --commit-stream write",
+        type=int,
+        default=4,
+    )
+    parser.add_argument(
+        "--hibernate-resume",
+        help="Compare cold boots of the fob with resumes from hibernation",
+        action="store_true",
+    )
+    parser.add_argument(
+        "--wakes", help="Cold boots and resumes for --hibernate-resume", type=int, default=20,
+    )
+    args = parser.parse_args()
+
+    scenario = None
+    if args.commit_stream:
+        scenario = commit_stream
+    elif args.hibernate_resume:
+        scenario = hibernate_resume
+
+    if scenario:
+        results = scenario(args)
+        output = json.dumps(results, indent=2)
+        print(output)
+        if args.results:
+            args.results.parent.mkdir(parents=True, exist_ok=True)
+            args.results.write_text(output + "\n")
+        if results["failures"]:
+            sys.exit(f"ERROR: {len(results['failures'])} failure(s)")
+        return
+
+    results = soak(args)
+
+    output = json.dumps(results, indent=2)
+    if args.summary:
+        link = results["link"]
+        print(
+            f"loss {args.loss:<5} {results['throughput_cycles_per_s']:>8} unlocks/s"
+            f"  p99 {results['latency_ms']['p99']} ms"
+            f"  failures {results['failures']['total']}"
+            f"  retransmits {link['car']['retransmits'] + link['fob']['retransmits']}"
+        )
+    else:
+        print(output)
+    if args.results:
+        args.results.parent.mkdir(parents=True, exist_ok=True)
+        args.results.write_text(output + "\n")
+
+    if args.save_baseline:
+        if args.baseline is None:
+            sys.exit("ERROR: --save-baseline needs --baseline")
+        args.baseline.write_text(output + "\n")
+        print(f"Saved baseline to {args.baseline}")
+        return
+
+    if args.baseline is None or not args.baseline.exists():
+        if args.baseline is not None:
+            print(f"No baseline at {args.baseline}, run with --save-baseline to store one")
+        if results["failures"]["total"]:
+            sys.exit("ERROR: some unlock cycles failed")
+        return
+
+    baseline = json.loads(args.baseline.read_text())
+    tolerances = {
+        "latency": args.latency_tolerance,
+        "stack": args.stack_tolerance,
+        "rss": args.rss_tolerance,
+    }
+    found = regressions(results, baseline, tolerances)
+    for regression in found:
+        print(f"REGRESSION {regression}")
+    if found:
+        sys.exit(f"ERROR: {len(found)} regression(s) against {args.baseline}")
+    print(f"No regressions against {args.baseline}")
+
+
+if __name__ == "__main__":
+    main()